@@ -258,6 +258,21 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// evaluationStatistics
+NumericVector evaluationStatistics(NumericVector observed, NumericVector modelled, IntegerVector period, int numPeriods, bool periodSums);
+RcppExport SEXP _medfate_evaluationStatistics(SEXP observedSEXP, SEXP modelledSEXP, SEXP periodSEXP, SEXP numPeriodsSEXP, SEXP periodSumsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type observed(observedSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type modelled(modelledSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type period(periodSEXP);
+    Rcpp::traits::input_parameter< int >::type numPeriods(numPeriodsSEXP);
+    Rcpp::traits::input_parameter< bool >::type periodSums(periodSumsSEXP);
+    rcpp_result_gen = Rcpp::wrap(evaluationStatistics(observed, modelled, period, numPeriods, periodSums));
+    return rcpp_result_gen;
+END_RCPP
+}
 // criticalFirelineIntensity
 double criticalFirelineIntensity(double CBH, double M);
 RcppExport SEXP _medfate_criticalFirelineIntensity(SEXP CBHSEXP, SEXP MSEXP) {
@@ -306,6 +321,65 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// removeCohorts
+List removeCohorts(List x, LogicalVector remove);
+RcppExport SEXP _medfate_removeCohorts(SEXP xSEXP, SEXP removeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type x(xSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type remove(removeSEXP);
+    rcpp_result_gen = Rcpp::wrap(removeCohorts(x, remove));
+    return rcpp_result_gen;
+END_RCPP
+}
+// replaceCohorts
+void replaceCohorts(List to, LogicalVector replace, List from, LogicalVector select);
+RcppExport SEXP _medfate_replaceCohorts(SEXP toSEXP, SEXP replaceSEXP, SEXP fromSEXP, SEXP selectSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type to(toSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type replace(replaceSEXP);
+    Rcpp::traits::input_parameter< List >::type from(fromSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type select(selectSEXP);
+    replaceCohorts(to, replace, from, select);
+    return R_NilValue;
+END_RCPP
+}
+// recruitmentLightLimited
+List recruitmentLightLimited(List forest, List recr_forest, DataFrame SpParams, LogicalVector tree_selection, NumericVector tree_minFPAR, NumericVector tree_maxN, LogicalVector shrub_selection, NumericVector shrub_minFPAR, NumericVector shrub_maxCover, double recrStepN);
+RcppExport SEXP _medfate_recruitmentLightLimited(SEXP forestSEXP, SEXP recr_forestSEXP, SEXP SpParamsSEXP, SEXP tree_selectionSEXP, SEXP tree_minFPARSEXP, SEXP tree_maxNSEXP, SEXP shrub_selectionSEXP, SEXP shrub_minFPARSEXP, SEXP shrub_maxCoverSEXP, SEXP recrStepNSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type forest(forestSEXP);
+    Rcpp::traits::input_parameter< List >::type recr_forest(recr_forestSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type SpParams(SpParamsSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type tree_selection(tree_selectionSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type tree_minFPAR(tree_minFPARSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type tree_maxN(tree_maxNSEXP);
+    Rcpp::traits::input_parameter< LogicalVector >::type shrub_selection(shrub_selectionSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type shrub_minFPAR(shrub_minFPARSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type shrub_maxCover(shrub_maxCoverSEXP);
+    Rcpp::traits::input_parameter< double >::type recrStepN(recrStepNSEXP);
+    rcpp_result_gen = Rcpp::wrap(recruitmentLightLimited(forest, recr_forest, SpParams, tree_selection, tree_minFPAR, tree_maxN, shrub_selection, shrub_minFPAR, shrub_maxCover, recrStepN));
+    return rcpp_result_gen;
+END_RCPP
+}
+// mergeCohorts
+List mergeCohorts(List x, double dbhTolerance, double heightTolerance, bool mergeShrubs);
+RcppExport SEXP _medfate_mergeCohorts(SEXP xSEXP, SEXP dbhToleranceSEXP, SEXP heightToleranceSEXP, SEXP mergeShrubsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type dbhTolerance(dbhToleranceSEXP);
+    Rcpp::traits::input_parameter< double >::type heightTolerance(heightToleranceSEXP);
+    Rcpp::traits::input_parameter< bool >::type mergeShrubs(mergeShrubsSEXP);
+    rcpp_result_gen = Rcpp::wrap(mergeCohorts(x, dbhTolerance, heightTolerance, mergeShrubs));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cohortIDs
 CharacterVector cohortIDs(List x, int treeOffset, int shrubOffset);
 RcppExport SEXP _medfate_cohortIDs(SEXP xSEXP, SEXP treeOffsetSEXP, SEXP shrubOffsetSEXP) {
@@ -1817,6 +1891,34 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// soilPlantResistancesSeries
+NumericMatrix soilPlantResistancesSeries(NumericMatrix psiSoil, NumericMatrix psiRhizo, NumericVector psiStem, NumericVector PLCstem, NumericVector psiLeaf, NumericVector krhizomax, NumericVector n, NumericVector alpha, NumericVector krootmax, double rootc, double rootd, double kstemmax, double stemc, double stemd, double kleafmax, double leafc, double leafd, bool relative);
+RcppExport SEXP _medfate_soilPlantResistancesSeries(SEXP psiSoilSEXP, SEXP psiRhizoSEXP, SEXP psiStemSEXP, SEXP PLCstemSEXP, SEXP psiLeafSEXP, SEXP krhizomaxSEXP, SEXP nSEXP, SEXP alphaSEXP, SEXP krootmaxSEXP, SEXP rootcSEXP, SEXP rootdSEXP, SEXP kstemmaxSEXP, SEXP stemcSEXP, SEXP stemdSEXP, SEXP kleafmaxSEXP, SEXP leafcSEXP, SEXP leafdSEXP, SEXP relativeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type psiSoil(psiSoilSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type psiRhizo(psiRhizoSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type psiStem(psiStemSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type PLCstem(PLCstemSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type psiLeaf(psiLeafSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type krhizomax(krhizomaxSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type n(nSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type alpha(alphaSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type krootmax(krootmaxSEXP);
+    Rcpp::traits::input_parameter< double >::type rootc(rootcSEXP);
+    Rcpp::traits::input_parameter< double >::type rootd(rootdSEXP);
+    Rcpp::traits::input_parameter< double >::type kstemmax(kstemmaxSEXP);
+    Rcpp::traits::input_parameter< double >::type stemc(stemcSEXP);
+    Rcpp::traits::input_parameter< double >::type stemd(stemdSEXP);
+    Rcpp::traits::input_parameter< double >::type kleafmax(kleafmaxSEXP);
+    Rcpp::traits::input_parameter< double >::type leafc(leafcSEXP);
+    Rcpp::traits::input_parameter< double >::type leafd(leafdSEXP);
+    Rcpp::traits::input_parameter< bool >::type relative(relativeSEXP);
+    rcpp_result_gen = Rcpp::wrap(soilPlantResistancesSeries(psiSoil, psiRhizo, psiStem, PLCstem, psiLeaf, krhizomax, n, alpha, krootmax, rootc, rootd, kstemmax, stemc, stemd, kleafmax, leafc, leafd, relative));
+    return rcpp_result_gen;
+END_RCPP
+}
 // averageRhizosphereResistancePercent
 double averageRhizosphereResistancePercent(double krhizomax, double n, double alpha, double krootmax, double rootc, double rootd, double kstemmax, double stemc, double stemd, double kleafmax, double leafc, double leafd, double psiStep);
 RcppExport SEXP _medfate_averageRhizosphereResistancePercent(SEXP krhizomaxSEXP, SEXP nSEXP, SEXP alphaSEXP, SEXP krootmaxSEXP, SEXP rootcSEXP, SEXP rootdSEXP, SEXP kstemmaxSEXP, SEXP stemcSEXP, SEXP stemdSEXP, SEXP kleafmaxSEXP, SEXP leafcSEXP, SEXP leafdSEXP, SEXP psiStepSEXP) {
@@ -2562,6 +2664,47 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// meteoBinaryInfo
+List meteoBinaryInfo(String file);
+RcppExport SEXP _medfate_meteoBinaryInfo(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< String >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(meteoBinaryInfo(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// meteoBinaryRead
+List meteoBinaryRead(String file, int site, int start, int numDays);
+RcppExport SEXP _medfate_meteoBinaryRead(SEXP fileSEXP, SEXP siteSEXP, SEXP startSEXP, SEXP numDaysSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< String >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< int >::type site(siteSEXP);
+    Rcpp::traits::input_parameter< int >::type start(startSEXP);
+    Rcpp::traits::input_parameter< int >::type numDays(numDaysSEXP);
+    rcpp_result_gen = Rcpp::wrap(meteoBinaryRead(file, site, start, numDays));
+    return rcpp_result_gen;
+END_RCPP
+}
+// meteoForcing
+DataFrame meteoForcing(DataFrame meteo, double latitude, double elevation, double slope, double aspect, List control);
+RcppExport SEXP _medfate_meteoForcing(SEXP meteoSEXP, SEXP latitudeSEXP, SEXP elevationSEXP, SEXP slopeSEXP, SEXP aspectSEXP, SEXP controlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< DataFrame >::type meteo(meteoSEXP);
+    Rcpp::traits::input_parameter< double >::type latitude(latitudeSEXP);
+    Rcpp::traits::input_parameter< double >::type elevation(elevationSEXP);
+    Rcpp::traits::input_parameter< double >::type slope(slopeSEXP);
+    Rcpp::traits::input_parameter< double >::type aspect(aspectSEXP);
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(meteoForcing(meteo, latitude, elevation, slope, aspect, control));
+    return rcpp_result_gen;
+END_RCPP
+}
 // paramsBelow
 List paramsBelow(DataFrame above, NumericVector Z50, NumericVector Z95, List soil, DataFrame paramsAnatomydf, DataFrame paramsTranspirationdf, List control);
 RcppExport SEXP _medfate_paramsBelow(SEXP aboveSEXP, SEXP Z50SEXP, SEXP Z95SEXP, SEXP soilSEXP, SEXP paramsAnatomydfSEXP, SEXP paramsTranspirationdfSEXP, SEXP controlSEXP) {
@@ -2651,6 +2794,35 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// forest2spwbInputBatch
+List forest2spwbInputBatch(List forests, List soil, DataFrame SpParams, List control, String mode);
+RcppExport SEXP _medfate_forest2spwbInputBatch(SEXP forestsSEXP, SEXP soilSEXP, SEXP SpParamsSEXP, SEXP controlSEXP, SEXP modeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type forests(forestsSEXP);
+    Rcpp::traits::input_parameter< List >::type soil(soilSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type SpParams(SpParamsSEXP);
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    Rcpp::traits::input_parameter< String >::type mode(modeSEXP);
+    rcpp_result_gen = Rcpp::wrap(forest2spwbInputBatch(forests, soil, SpParams, control, mode));
+    return rcpp_result_gen;
+END_RCPP
+}
+// forest2growthInputBatch
+List forest2growthInputBatch(List forests, List soil, DataFrame SpParams, List control);
+RcppExport SEXP _medfate_forest2growthInputBatch(SEXP forestsSEXP, SEXP soilSEXP, SEXP SpParamsSEXP, SEXP controlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type forests(forestsSEXP);
+    Rcpp::traits::input_parameter< List >::type soil(soilSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type SpParams(SpParamsSEXP);
+    Rcpp::traits::input_parameter< List >::type control(controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(forest2growthInputBatch(forests, soil, SpParams, control));
+    return rcpp_result_gen;
+END_RCPP
+}
 // resetInputs
 void resetInputs(List x);
 RcppExport SEXP _medfate_resetInputs(SEXP xSEXP) {
@@ -3027,6 +3199,26 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// simulationCancelToken
+Environment simulationCancelToken();
+RcppExport SEXP _medfate_simulationCancelToken() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(simulationCancelToken());
+    return rcpp_result_gen;
+END_RCPP
+}
+// requestSimulationCancel
+void requestSimulationCancel(SEXP token);
+RcppExport SEXP _medfate_requestSimulationCancel(SEXP tokenSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type token(tokenSEXP);
+    requestSimulationCancel(token);
+    return R_NilValue;
+END_RCPP
+}
 // conicDistribution
 NumericMatrix conicDistribution(NumericVector Zcone, NumericVector d);
 RcppExport SEXP _medfate_conicDistribution(SEXP ZconeSEXP, SEXP dSEXP) {
@@ -3064,6 +3256,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// movingAverageMinimumMean
+double movingAverageMinimumMean(NumericVector x, IntegerVector group, int n);
+RcppExport SEXP _medfate_movingAverageMinimumMean(SEXP xSEXP, SEXP groupSEXP, SEXP nSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type x(xSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type group(groupSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(movingAverageMinimumMean(x, group, n));
+    return rcpp_result_gen;
+END_RCPP
+}
 // individualRootedGroundArea
 NumericMatrix individualRootedGroundArea(NumericVector VolInd, NumericMatrix V, NumericVector d, NumericVector rfc);
 RcppExport SEXP _medfate_individualRootedGroundArea(SEXP VolIndSEXP, SEXP VSEXP, SEXP dSEXP, SEXP rfcSEXP) {
@@ -3248,6 +3453,69 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// sensitivityLHS
+NumericMatrix sensitivityLHS(int n, int k);
+RcppExport SEXP _medfate_sensitivityLHS(SEXP nSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(sensitivityLHS(n, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sensitivityMorrisDesign
+NumericMatrix sensitivityMorrisDesign(int r, int k, int levels);
+RcppExport SEXP _medfate_sensitivityMorrisDesign(SEXP rSEXP, SEXP kSEXP, SEXP levelsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type r(rSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< int >::type levels(levelsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sensitivityMorrisDesign(r, k, levels));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sensitivityMorrisIndices
+List sensitivityMorrisIndices(NumericMatrix X, NumericMatrix Y, int r);
+RcppExport SEXP _medfate_sensitivityMorrisIndices(SEXP XSEXP, SEXP YSEXP, SEXP rSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type X(XSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< int >::type r(rSEXP);
+    rcpp_result_gen = Rcpp::wrap(sensitivityMorrisIndices(X, Y, r));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sensitivitySobolIndices
+List sensitivitySobolIndices(NumericMatrix Y, int n, int k);
+RcppExport SEXP _medfate_sensitivitySobolIndices(SEXP YSEXP, SEXP nSEXP, SEXP kSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type Y(YSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    rcpp_result_gen = Rcpp::wrap(sensitivitySobolIndices(Y, n, k));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sensitivityRankCorrelation
+NumericMatrix sensitivityRankCorrelation(NumericMatrix X, NumericMatrix Y);
+RcppExport SEXP _medfate_sensitivityRankCorrelation(SEXP XSEXP, SEXP YSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type X(XSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type Y(YSEXP);
+    rcpp_result_gen = Rcpp::wrap(sensitivityRankCorrelation(X, Y));
+    return rcpp_result_gen;
+END_RCPP
+}
 // saturatedConductivitySaxton
 double saturatedConductivitySaxton(double clay, double sand, double om, bool mmol);
 static SEXP _medfate_saturatedConductivitySaxton_try(SEXP claySEXP, SEXP sandSEXP, SEXP omSEXP, SEXP mmolSEXP) {
@@ -4580,6 +4848,40 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// verticalProfileVectors
+List verticalProfileVectors(NumericVector z, NumericVector LAI, NumericVector H, NumericVector CR, NumericVector kPAR, NumericVector fuel, IntegerVector group, int numGroups);
+RcppExport SEXP _medfate_verticalProfileVectors(SEXP zSEXP, SEXP LAISEXP, SEXP HSEXP, SEXP CRSEXP, SEXP kPARSEXP, SEXP fuelSEXP, SEXP groupSEXP, SEXP numGroupsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type z(zSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type LAI(LAISEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type H(HSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type CR(CRSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type kPAR(kPARSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type fuel(fuelSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type group(groupSEXP);
+    Rcpp::traits::input_parameter< int >::type numGroups(numGroupsSEXP);
+    rcpp_result_gen = Rcpp::wrap(verticalProfileVectors(z, LAI, H, CR, kPAR, fuel, group, numGroups));
+    return rcpp_result_gen;
+END_RCPP
+}
+// verticalProfilesForests
+List verticalProfilesForests(List forests, NumericVector z, DataFrame SpParams, double gdd, String mode, CharacterVector profiles);
+RcppExport SEXP _medfate_verticalProfilesForests(SEXP forestsSEXP, SEXP zSEXP, SEXP SpParamsSEXP, SEXP gddSEXP, SEXP modeSEXP, SEXP profilesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type forests(forestsSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type z(zSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type SpParams(SpParamsSEXP);
+    Rcpp::traits::input_parameter< double >::type gdd(gddSEXP);
+    Rcpp::traits::input_parameter< String >::type mode(modeSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type profiles(profilesSEXP);
+    rcpp_result_gen = Rcpp::wrap(verticalProfilesForests(forests, z, SpParams, gdd, mode, profiles));
+    return rcpp_result_gen;
+END_RCPP
+}
 // windCanopyTurbulenceModel
 DataFrame windCanopyTurbulenceModel(NumericVector zm, NumericVector Cx, double hm, double d0, double z0, String model);
 RcppExport SEXP _medfate_windCanopyTurbulenceModel(SEXP zmSEXP, SEXP CxSEXP, SEXP hmSEXP, SEXP d0SEXP, SEXP z0SEXP, SEXP modelSEXP) {
@@ -4858,9 +5160,14 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_sapwoodStructuralLivingBiomass", (DL_FUNC) &_medfate_sapwoodStructuralLivingBiomass, 6},
     {"_medfate_sapwoodStarchCapacity", (DL_FUNC) &_medfate_sapwoodStarchCapacity, 6},
     {"_medfate_carbonCompartments", (DL_FUNC) &_medfate_carbonCompartments, 2},
+    {"_medfate_evaluationStatistics", (DL_FUNC) &_medfate_evaluationStatistics, 5},
     {"_medfate_criticalFirelineIntensity", (DL_FUNC) &_medfate_criticalFirelineIntensity, 2},
     {"_medfate_FCCSbehaviour", (DL_FUNC) &_medfate_FCCSbehaviour, 5},
     {"_medfate_rothermel", (DL_FUNC) &_medfate_rothermel, 11},
+    {"_medfate_removeCohorts", (DL_FUNC) &_medfate_removeCohorts, 2},
+    {"_medfate_replaceCohorts", (DL_FUNC) &_medfate_replaceCohorts, 4},
+    {"_medfate_recruitmentLightLimited", (DL_FUNC) &_medfate_recruitmentLightLimited, 10},
+    {"_medfate_mergeCohorts", (DL_FUNC) &_medfate_mergeCohorts, 4},
     {"_medfate_cohortIDs", (DL_FUNC) &_medfate_cohortIDs, 3},
     {"_medfate_cohortSpecies", (DL_FUNC) &_medfate_cohortSpecies, 1},
     {"_medfate_cohortSpeciesName", (DL_FUNC) &_medfate_cohortSpeciesName, 2},
@@ -4953,6 +5260,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_psi2Weibull", (DL_FUNC) &_medfate_psi2Weibull, 3},
     {"_medfate_maximumSoilPlantConductance", (DL_FUNC) &_medfate_maximumSoilPlantConductance, 4},
     {"_medfate_soilPlantResistances", (DL_FUNC) &_medfate_soilPlantResistances, 17},
+    {"_medfate_soilPlantResistancesSeries", (DL_FUNC) &_medfate_soilPlantResistancesSeries, 18},
     {"_medfate_averageRhizosphereResistancePercent", (DL_FUNC) &_medfate_averageRhizosphereResistancePercent, 13},
     {"_medfate_findRhizosphereMaximumConductance", (DL_FUNC) &_medfate_findRhizosphereMaximumConductance, 13},
     {"_medfate_taperFactorSavage", (DL_FUNC) &_medfate_taperFactorSavage, 1},
@@ -4989,12 +5297,17 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_layerSunlitFraction", (DL_FUNC) &_medfate_layerSunlitFraction, 3},
     {"_medfate_instantaneousLightExtinctionAbsortion", (DL_FUNC) &_medfate_instantaneousLightExtinctionAbsortion, 9},
     {"_medfate_longwaveRadiationSHAW", (DL_FUNC) &_medfate_longwaveRadiationSHAW, 7},
+    {"_medfate_meteoBinaryInfo", (DL_FUNC) &_medfate_meteoBinaryInfo, 1},
+    {"_medfate_meteoBinaryRead", (DL_FUNC) &_medfate_meteoBinaryRead, 4},
+    {"_medfate_meteoForcing", (DL_FUNC) &_medfate_meteoForcing, 6},
     {"_medfate_paramsBelow", (DL_FUNC) &_medfate_paramsBelow, 7},
     {"_medfate_spwbInput", (DL_FUNC) &_medfate_spwbInput, 6},
     {"_medfate_growthInput", (DL_FUNC) &_medfate_growthInput, 6},
     {"_medfate_cloneInput", (DL_FUNC) &_medfate_cloneInput, 1},
     {"_medfate_forest2spwbInput", (DL_FUNC) &_medfate_forest2spwbInput, 5},
     {"_medfate_forest2growthInput", (DL_FUNC) &_medfate_forest2growthInput, 4},
+    {"_medfate_forest2spwbInputBatch", (DL_FUNC) &_medfate_forest2spwbInputBatch, 5},
+    {"_medfate_forest2growthInputBatch", (DL_FUNC) &_medfate_forest2growthInputBatch, 4},
     {"_medfate_resetInputs", (DL_FUNC) &_medfate_resetInputs, 1},
     {"_medfate_updateBelow", (DL_FUNC) &_medfate_updateBelow, 1},
     {"_medfate_multiplyInputParam", (DL_FUNC) &_medfate_multiplyInputParam, 6},
@@ -5020,9 +5333,12 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_leafPhotosynthesisFunction2", (DL_FUNC) &_medfate_leafPhotosynthesisFunction2, 15},
     {"_medfate_sunshadePhotosynthesisFunction", (DL_FUNC) &_medfate_sunshadePhotosynthesisFunction, 19},
     {"_medfate_multilayerPhotosynthesisFunction", (DL_FUNC) &_medfate_multilayerPhotosynthesisFunction, 17},
+    {"_medfate_simulationCancelToken", (DL_FUNC) &_medfate_simulationCancelToken, 0},
+    {"_medfate_requestSimulationCancel", (DL_FUNC) &_medfate_requestSimulationCancel, 1},
     {"_medfate_conicDistribution", (DL_FUNC) &_medfate_conicDistribution, 2},
     {"_medfate_ldrDistribution", (DL_FUNC) &_medfate_ldrDistribution, 3},
     {"_medfate_rootDistribution", (DL_FUNC) &_medfate_rootDistribution, 2},
+    {"_medfate_movingAverageMinimumMean", (DL_FUNC) &_medfate_movingAverageMinimumMean, 3},
     {"_medfate_individualRootedGroundArea", (DL_FUNC) &_medfate_individualRootedGroundArea, 4},
     {"_medfate_specificRootSurfaceArea", (DL_FUNC) &_medfate_specificRootSurfaceArea, 2},
     {"_medfate_fineRootRadius", (DL_FUNC) &_medfate_fineRootRadius, 2},
@@ -5036,6 +5352,11 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_coarseRootLengths", (DL_FUNC) &_medfate_coarseRootLengths, 3},
     {"_medfate_coarseRootSoilVolume", (DL_FUNC) &_medfate_coarseRootSoilVolume, 3},
     {"_medfate_horizontalProportions", (DL_FUNC) &_medfate_horizontalProportions, 6},
+    {"_medfate_sensitivityLHS", (DL_FUNC) &_medfate_sensitivityLHS, 2},
+    {"_medfate_sensitivityMorrisDesign", (DL_FUNC) &_medfate_sensitivityMorrisDesign, 3},
+    {"_medfate_sensitivityMorrisIndices", (DL_FUNC) &_medfate_sensitivityMorrisIndices, 3},
+    {"_medfate_sensitivitySobolIndices", (DL_FUNC) &_medfate_sensitivitySobolIndices, 3},
+    {"_medfate_sensitivityRankCorrelation", (DL_FUNC) &_medfate_sensitivityRankCorrelation, 2},
     {"_medfate_saturatedConductivitySaxton", (DL_FUNC) &_medfate_saturatedConductivitySaxton, 4},
     {"_medfate_unsaturatedConductivitySaxton", (DL_FUNC) &_medfate_unsaturatedConductivitySaxton, 5},
     {"_medfate_thetaSATSaxton", (DL_FUNC) &_medfate_thetaSATSaxton, 3},
@@ -5079,6 +5400,8 @@ static const R_CallMethodDef CallEntries[] = {
     {"_medfate_profitMaximization", (DL_FUNC) &_medfate_profitMaximization, 7},
     {"_medfate_transpirationSperry", (DL_FUNC) &_medfate_transpirationSperry, 12},
     {"_medfate_transpirationGranier", (DL_FUNC) &_medfate_transpirationGranier, 4},
+    {"_medfate_verticalProfileVectors", (DL_FUNC) &_medfate_verticalProfileVectors, 8},
+    {"_medfate_verticalProfilesForests", (DL_FUNC) &_medfate_verticalProfilesForests, 6},
     {"_medfate_windCanopyTurbulenceModel", (DL_FUNC) &_medfate_windCanopyTurbulenceModel, 6},
     {"_medfate_windCanopyTurbulence", (DL_FUNC) &_medfate_windCanopyTurbulence, 6},
     {"_medfate_windSpeedAtCanopyHeight", (DL_FUNC) &_medfate_windSpeedAtCanopyHeight, 2},
@@ -5094,7 +5417,9 @@ static const R_CallMethodDef CallEntries[] = {
     {NULL, NULL, 0}
 };
 
+void meteoBinaryInit(DllInfo* dll);
 RcppExport void R_init_medfate(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    meteoBinaryInit(dll);
 }
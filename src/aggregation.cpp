@@ -0,0 +1,443 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include "aggregation.h"
+using namespace Rcpp;
+
+/**
+ * Temporal aggregation of daily outputs during simulations.
+ * 
+ * Periods are given by element 'period' of control parameter 'aggregation' (either "month", 
+ * "year" or a vector of period labels, one per day). Aggregation functions (sum, mean, max or min,
+ * ignoring missing values) are chosen for each output through element 'FUN' (names of the form 
+ * "Plants$Transpiration", "Plants" or "default"). If 'bySpecies' is true, cohort-level outputs are 
+ * summed (leaf area) or averaged weighting by the leaf area index of cohorts (other variables) 
+ * within species before being accumulated.
+ */
+static bool isPlantOutput(std::string top) {
+  return((top=="Plants") || (top=="SunlitLeaves") || (top=="ShadeLeaves") ||
+         (top=="LabileCarbonBalance") || (top=="PlantBiomassBalance") || 
+         (top=="PlantStructure") || (top=="GrowthMortality"));
+}
+static bool isBufferLeaf(SEXP obj) {
+  if(TYPEOF(obj)!=REALSXP) return(false);
+  return(Rf_length(obj)==(2*Rf_ncols(obj)));
+}
+static std::string elementName(SEXP names, int j) {
+  if(names==R_NilValue) return("");
+  return(std::string(CHAR(STRING_ELT(names, j))));
+}
+
+// Period index (0-based) of each simulated day, returning period labels (in order of appearance).
+// Months and years are labelled by their first date, as the levels of cut(dates, breaks = "months"/"years")
+static CharacterVector aggregationPeriods(SEXP period, CharacterVector dateStrings, std::vector<int>& dayPeriod) {
+  int numDays = dateStrings.size();
+  CharacterVector periodVec = Rcpp::as<Rcpp::CharacterVector>(period);
+  std::vector<std::string> labels(numDays);
+  if(periodVec.size()==numDays) {
+    for(int d=0;d<numDays;d++) labels[d] = Rcpp::as<std::string>(periodVec[d]);
+  } else if(periodVec.size()==1) {
+    std::string p = Rcpp::as<std::string>(periodVec[0]);
+    size_t len = 0;
+    std::string suffix;
+    if(p=="year") {
+      len = 4;
+      suffix = "-01-01";
+    } else if(p=="month") {
+      len = 7;
+      suffix = "-01";
+    }
+    else stop("Aggregation period should be either 'month', 'year' or a vector with one label per day");
+    for(int d=0;d<numDays;d++) labels[d] = Rcpp::as<std::string>(dateStrings[d]).substr(0, len) + suffix;
+  } else {
+    stop("Aggregation period should be either 'month', 'year' or a vector with one label per day");
+  }
+  std::map<std::string, int> index;
+  std::vector<std::string> uniqueLabels;
+  dayPeriod.resize(numDays);
+  for(int d=0;d<numDays;d++) {
+    std::map<std::string, int>::iterator it = index.find(labels[d]);
+    if(it==index.end()) {
+      index[labels[d]] = uniqueLabels.size();
+      dayPeriod[d] = uniqueLabels.size();
+      uniqueLabels.push_back(labels[d]);
+    } else {
+      dayPeriod[d] = it->second;
+    }
+  }
+  CharacterVector periodLabels(uniqueLabels.size());
+  for(size_t p=0;p<uniqueLabels.size();p++) periodLabels[p] = uniqueLabels[p];
+  return(periodLabels);
+}
+
+// Species (sorted unique cohort names) of cohorts, returning species names
+static CharacterVector cohortSpeciesIndex(DataFrame cohorts, std::vector<int>& cohortSpecies) {
+  CharacterVector names = Rcpp::as<Rcpp::CharacterVector>(cohorts["Name"]);
+  int numCohorts = names.size();
+  std::vector<std::string> sp(numCohorts);
+  for(int c=0;c<numCohorts;c++) sp[c] = Rcpp::as<std::string>(names[c]);
+  std::vector<std::string> levels = sp;
+  std::sort(levels.begin(), levels.end());
+  levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+  CharacterVector speciesNames(levels.size());
+  for(size_t s=0;s<levels.size();s++) speciesNames[s] = levels[s];
+  cohortSpecies.resize(numCohorts);
+  for(int c=0;c<numCohorts;c++) cohortSpecies[c] = std::lower_bound(levels.begin(), levels.end(), sp[c]) - levels.begin();
+  return(speciesNames);
+}
+
+TemporalAggregator::TemporalAggregator(List control, CharacterVector dateStrings, DataFrame cohorts) {
+  active = false;
+  bySpecies = false;
+  nperiods = 0;
+  numCohorts = 0;
+  weights = R_NilValue;
+  if(!control.containsElementNamed("aggregation")) return;
+  if(TYPEOF(control["aggregation"])==NILSXP) return;
+  spec = Rcpp::as<Rcpp::List>(control["aggregation"]);
+  if(!spec.containsElementNamed("period")) stop("Element 'period' missing in control parameter 'aggregation'");
+  periodLabels = aggregationPeriods(spec["period"], dateStrings, dayPeriod);
+  nperiods = periodLabels.size();
+  periodDays.assign(nperiods, 0);
+  
+  if(spec.containsElementNamed("bySpecies")) bySpecies = Rcpp::as<bool>(spec["bySpecies"]);
+  if(bySpecies) {
+    speciesNames = cohortSpeciesIndex(cohorts, cohortSpecies);
+    numCohorts = cohortSpecies.size();
+  }
+  active = true;
+}
+
+int TemporalAggregator::outputRows(int numDays) {
+  if(active) return(2);
+  return(numDays);
+}
+
+// Frame whose row names define the rows of daily output tables
+DataFrame TemporalAggregator::outputFrame(DataFrame meteo) {
+  if(!active) return(meteo);
+  List rows(0);
+  rows.attr("row.names") = CharacterVector::create("1", "2");
+  rows.attr("class") = CharacterVector::create("data.frame");
+  return(DataFrame(rows));
+}
+
+int TemporalAggregator::leafFunction(std::string top, std::string name) {
+  std::string f = "";
+  if(spec.containsElementNamed("FUN")) {
+    CharacterVector fun = Rcpp::as<Rcpp::CharacterVector>(spec["FUN"]);
+    SEXP funNames = Rf_getAttrib(fun, R_NamesSymbol);
+    std::string keys[3] = {top + "$" + name, top, "default"};
+    for(int k=0;(k<3) && (f=="");k++) {
+      for(int j=0;j<fun.size();j++) {
+        std::string nm = elementName(funNames, j);
+        if((nm==keys[k]) || ((k==2) && (nm==""))) {
+          f = Rcpp::as<std::string>(fun[j]);
+          break;
+        }
+      }
+    }
+  }
+  if(f=="") {
+    if((top=="WaterBalance") || (top=="EnergyBalance") || (top=="BiomassBalance") || (top=="PlantBiomassBalance")) f = "sum";
+    else if((top=="Plants") && ((name=="Transpiration") || (name=="GrossPhotosynthesis") || (name=="NetPhotosynthesis") ||
+                                (name=="AbsorbedSWR") || (name=="NetLWR"))) f = "sum";
+    else f = "mean";
+  }
+  if(f=="sum") return(AGGREGATION_SUM);
+  else if(f=="mean") return(AGGREGATION_MEAN);
+  else if(f=="max") return(AGGREGATION_MAX);
+  else if(f=="min") return(AGGREGATION_MIN);
+  stop("Wrong aggregation function '%s' (should be 'sum', 'mean', 'max' or 'min')", f);
+}
+
+void TemporalAggregator::collectLeaves(SEXP obj, std::string top, std::string name, int depth) {
+  if(isBufferLeaf(obj)) {
+    Leaf leaf;
+    leaf.top = top;
+    leaf.name = name;
+    leaf.daily = obj;
+    leaf.ncol = Rf_ncols(obj);
+    leaf.bySpecies = bySpecies && (depth==1) && isPlantOutput(top) && Rf_isMatrix(obj) && (leaf.ncol==numCohorts);
+    leaf.sumSpecies = (name.compare(0, 3, "LAI")==0);
+    leaf.ncolOut = (leaf.bySpecies ? speciesNames.size() : leaf.ncol);
+    leaf.fun = leafFunction(top, name);
+    double* v = REAL(obj);
+    leaf.row1.resize(leaf.ncol);
+    for(int j=0;j<leaf.ncol;j++) leaf.row1[j] = v[2*j + 1];
+    double ini = 0.0;
+    if(leaf.fun==AGGREGATION_MAX) ini = -std::numeric_limits<double>::infinity();
+    else if(leaf.fun==AGGREGATION_MIN) ini = std::numeric_limits<double>::infinity();
+    leaf.value.assign(nperiods*leaf.ncolOut, ini);
+    leaf.count.assign(nperiods*leaf.ncolOut, 0.0);
+    leaves.push_back(leaf);
+  } else if(TYPEOF(obj)==VECSXP) {
+    SEXP names = Rf_getAttrib(obj, R_NamesSymbol);
+    for(int j=0;j<Rf_length(obj);j++) {
+      collectLeaves(VECTOR_ELT(obj, j), top, (depth==0 ? elementName(names, j) : name), depth + 1);
+    }
+  }
+}
+
+// Registers the (named) list of daily outputs to be aggregated
+void TemporalAggregator::setBuffer(List b) {
+  buffer = b;
+  leaves.clear();
+  SEXP names = Rf_getAttrib(buffer, R_NamesSymbol);
+  for(int i=0;i<buffer.size();i++) collectLeaves(VECTOR_ELT(buffer, i), elementName(names, i), "", 0);
+  if(bySpecies) {
+    if(!buffer.containsElementNamed("Plants")) stop("Aggregation by species requires daily plant outputs");
+    List plants = buffer["Plants"];
+    if(!plants.containsElementNamed("LAI")) stop("Aggregation by species requires daily plant leaf area index");
+    weights = plants["LAI"];
+  }
+}
+
+// Accumulates the first buffer row into the period of 'day' and shifts the buffer
+void TemporalAggregator::addDay(int day) {
+  int p = dayPeriod[day];
+  periodDays[p] += 1;
+  int nspecies = speciesNames.size();
+  std::vector<double> num(nspecies), den(nspecies);
+  for(size_t i=0;i<leaves.size();i++) {
+    Leaf& leaf = leaves[i];
+    double* v = REAL(leaf.daily);
+    for(int j=0;j<leaf.ncolOut;j++) {
+      double x;
+      if(leaf.bySpecies) {
+        if(j==0) {
+          double* w = REAL(weights);
+          std::fill(num.begin(), num.end(), 0.0);
+          std::fill(den.begin(), den.end(), 0.0);
+          for(int c=0;c<numCohorts;c++) {
+            double xc = v[2*c];
+            if(NumericVector::is_na(xc)) continue;
+            if(leaf.sumSpecies) {
+              num[cohortSpecies[c]] += xc;
+              den[cohortSpecies[c]] = 1.0;
+            } else if(!NumericVector::is_na(w[2*c])) {
+              num[cohortSpecies[c]] += w[2*c]*xc;
+              den[cohortSpecies[c]] += w[2*c];
+            }
+          }
+        }
+        x = (den[j] > 0.0 ? num[j]/den[j] : NA_REAL);
+      } else {
+        x = v[2*j];
+      }
+      if(NumericVector::is_na(x)) continue;
+      int k = p + nperiods*j;
+      if(leaf.fun==AGGREGATION_MAX) leaf.value[k] = std::max(leaf.value[k], x);
+      else if(leaf.fun==AGGREGATION_MIN) leaf.value[k] = std::min(leaf.value[k], x);
+      else leaf.value[k] += x;
+      leaf.count[k] += 1.0;
+    }
+  }
+  //Shift buffers (after accumulation, as species weights are also buffered)
+  for(size_t i=0;i<leaves.size();i++) {
+    Leaf& leaf = leaves[i];
+    double* v = REAL(leaf.daily);
+    for(int j=0;j<leaf.ncol;j++) {
+      v[2*j] = v[2*j + 1];
+      v[2*j + 1] = leaf.row1[j];
+    }
+  }
+}
+
+SEXP TemporalAggregator::buildResult(SEXP obj, std::string top, int depth, size_t& ileaf, 
+                                     CharacterVector rows, IntegerVector keep) {
+  int nk = keep.size();
+  if(isBufferLeaf(obj)) {
+    Leaf& leaf = leaves[ileaf++];
+    NumericMatrix m(nk, leaf.ncolOut);
+    for(int r=0;r<nk;r++) {
+      for(int j=0;j<leaf.ncolOut;j++) {
+        int k = keep[r] + nperiods*j;
+        if(leaf.count[k]==0.0) m(r,j) = (leaf.fun==AGGREGATION_SUM ? 0.0 : NA_REAL);
+        else if(leaf.fun==AGGREGATION_MEAN) m(r,j) = leaf.value[k]/leaf.count[k];
+        else m(r,j) = leaf.value[k];
+      }
+    }
+    if(!Rf_isMatrix(obj)) {
+      NumericVector vec(nk);
+      for(int r=0;r<nk;r++) vec[r] = m(r,0);
+      return(vec);
+    }
+    SEXP colNames = R_NilValue;
+    if(leaf.bySpecies) {
+      colNames = speciesNames;
+    } else {
+      SEXP dn = Rf_getAttrib(obj, R_DimNamesSymbol);
+      if(dn!=R_NilValue) colNames = VECTOR_ELT(dn, 1);
+    }
+    m.attr("dimnames") = List::create(rows, colNames);
+    return(m);
+  } else if(TYPEOF(obj)==VECSXP) {
+    int n = Rf_length(obj);
+    List out(n);
+    bool vectors = true;
+    SEXP names = Rf_getAttrib(obj, R_NamesSymbol);
+    for(int j=0;j<n;j++) {
+      SEXP el = VECTOR_ELT(obj, j);
+      if(Rf_isMatrix(el) || (TYPEOF(el)!=REALSXP)) vectors = false;
+      out[j] = buildResult(el, (depth==0 ? elementName(names, j) : top), depth + 1, ileaf, rows, keep);
+    }
+    if(names!=R_NilValue) out.attr("names") = names;
+    if((n > 0) && (Rf_inherits(obj, "data.frame") || vectors)) {
+      out.attr("row.names") = rows;
+      out.attr("class") = CharacterVector::create("data.frame");
+    }
+    return(out);
+  }
+  return(obj);
+}
+
+// Aggregated outputs (only periods with at least one simulated day)
+List TemporalAggregator::result() {
+  std::vector<int> kept;
+  for(int p=0;p<nperiods;p++) if(periodDays[p] > 0) kept.push_back(p);
+  IntegerVector keep(kept.size());
+  CharacterVector rows(kept.size());
+  for(size_t r=0;r<kept.size();r++) {
+    keep[r] = kept[r];
+    rows[r] = periodLabels[kept[r]];
+  }
+  size_t ileaf = 0;
+  List out(buffer.size());
+  SEXP names = Rf_getAttrib(buffer, R_NamesSymbol);
+  for(int i=0;i<buffer.size();i++) {
+    out[i] = buildResult(VECTOR_ELT(buffer, i), elementName(names, i), 0, ileaf, rows, keep);
+  }
+  out.attr("names") = names;
+  return(out);
+}
+
+DroughtStressAccumulator::DroughtStressAccumulator(List control, CharacterVector dateStrings, DataFrame cohorts) {
+  active = false;
+  nperiods = 0;
+  numCohorts = 0;
+  if(!control.containsElementNamed("droughtStressPeriod")) return;
+  if(TYPEOF(control["droughtStressPeriod"])==NILSXP) return;
+  CharacterVector period = Rcpp::as<Rcpp::CharacterVector>(control["droughtStressPeriod"]);
+  periodType = "custom";
+  if(period.size()==1) periodType = Rcpp::as<std::string>(period[0]);
+  periodLabels = aggregationPeriods(period, dateStrings, dayPeriod);
+  nperiods = periodLabels.size();
+  periodDays.assign(nperiods, 0);
+  cohortNames = cohorts.attr("row.names");
+  speciesNames = cohortSpeciesIndex(cohorts, cohortSpecies);
+  numCohorts = cohortSpecies.size();
+  int n = nperiods*numCohorts;
+  ndays.assign(n, 0.0);
+  nstress.assign(n, 0.0);
+  nna.assign(n, 0.0);
+  ndd.assign(n, 0.0);
+  di.assign(n, 0.0);
+  sumStress.assign(n, 0.0);
+  maxStress.assign(n, -std::numeric_limits<double>::infinity());
+  npsi.assign(n, 0.0);
+  sumPsi.assign(n, 0.0);
+  maxPsi.assign(n, -std::numeric_limits<double>::infinity());
+  maxLAI.assign(numCohorts, -std::numeric_limits<double>::infinity());
+  active = true;
+}
+
+// Accumulates daily plant results (element 'Plants' of spwb_day objects)
+void DroughtStressAccumulator::addDay(int day, List plants, String transpirationMode) {
+  NumericVector DDS = Rcpp::as<Rcpp::NumericVector>(plants["DDS"]);
+  NumericVector LAI = Rcpp::as<Rcpp::NumericVector>(plants["LAI"]);
+  NumericVector psi;
+  if(transpirationMode=="Granier") psi = Rcpp::as<Rcpp::NumericVector>(plants["PlantPsi"]);
+  else psi = Rcpp::as<Rcpp::NumericVector>(plants["LeafPsiMin"]);
+  int p = dayPeriod[day];
+  periodDays[p] += 1;
+  for(int c=0;c<numCohorts;c++) {
+    int k = p + nperiods*c;
+    ndays[k] += 1.0;
+    double dds = DDS[c];
+    if(NumericVector::is_na(dds)) {
+      nna[k] += 1.0;
+    } else {
+      nstress[k] += 1.0;
+      if(dds > 0.5) ndd[k] += 1.0;
+      di[k] += std::max(0.0, (dds - 0.5)/0.5);
+      sumStress[k] += dds;
+      maxStress[k] = std::max(maxStress[k], dds);
+    }
+    if(!NumericVector::is_na(psi[c])) {
+      npsi[k] += 1.0;
+      sumPsi[k] += psi[c];
+      maxPsi[k] = std::max(maxPsi[k], psi[c]);
+    }
+    if(!NumericVector::is_na(LAI[c])) maxLAI[c] = std::max(maxLAI[c], LAI[c]);
+  }
+}
+
+NumericMatrix DroughtStressAccumulator::indexMatrix(std::string index, IntegerVector keep, bool bySpecies) {
+  int nk = keep.size();
+  NumericMatrix M(nk, numCohorts);
+  for(int r=0;r<nk;r++) {
+    for(int c=0;c<numCohorts;c++) {
+      int k = keep[r] + nperiods*c;
+      double v = NA_REAL;
+      if(index=="NDD") {
+        if(nna[k]==0.0) v = ndd[k];
+      } else if(index=="DI") {
+        if(nna[k]==0.0) v = di[k]/ndays[k];
+      } else if(index=="ADS") {
+        if(nstress[k] > 0.0) v = sumStress[k]/nstress[k];
+      } else if(index=="MDS") {
+        if(nstress[k] > 0.0) v = maxStress[k];
+      } else if(index=="WSI") {
+        if(npsi[k] > 0.0) v = std::abs(sumPsi[k] - npsi[k]*maxPsi[k]);
+      }
+      M(r,c) = v;
+    }
+  }
+  if(!bySpecies) return(M);
+  //LAI-weighted average of cohort indices within species, using maximum cohort LAI
+  int nspecies = speciesNames.size();
+  NumericMatrix S(nk, nspecies);
+  std::vector<double> laiSp(nspecies, 0.0);
+  for(int c=0;c<numCohorts;c++) if(maxLAI[c] > 0.0) laiSp[cohortSpecies[c]] += maxLAI[c];
+  for(int r=0;r<nk;r++) {
+    std::vector<double> num(nspecies, 0.0);
+    for(int c=0;c<numCohorts;c++) {
+      if((maxLAI[c] > 0.0) && (!NumericVector::is_na(M(r,c)))) num[cohortSpecies[c]] += M(r,c)*maxLAI[c];
+    }
+    for(int s=0;s<nspecies;s++) S(r,s) = (laiSp[s] > 0.0 ? num[s]/laiSp[s] : NA_REAL);
+  }
+  return(S);
+}
+
+// Drought stress indices of cohorts and species (only periods with at least one simulated day)
+List DroughtStressAccumulator::result() {
+  std::vector<int> kept;
+  for(int p=0;p<nperiods;p++) if(periodDays[p] > 0) kept.push_back(p);
+  IntegerVector keep(kept.size());
+  CharacterVector rows(kept.size());
+  for(size_t r=0;r<kept.size();r++) {
+    keep[r] = kept[r];
+    rows[r] = periodLabels[kept[r]];
+  }
+  CharacterVector indices = CharacterVector::create("NDD", "DI", "ADS", "MDS", "WSI");
+  List cohortIndices(indices.size()), speciesIndices(indices.size());
+  for(int i=0;i<indices.size();i++) {
+    std::string index = Rcpp::as<std::string>(indices[i]);
+    NumericMatrix MC = indexMatrix(index, keep, false);
+    MC.attr("dimnames") = List::create(rows, cohortNames);
+    cohortIndices[i] = MC;
+    NumericMatrix MS = indexMatrix(index, keep, true);
+    MS.attr("dimnames") = List::create(rows, speciesNames);
+    speciesIndices[i] = MS;
+  }
+  cohortIndices.attr("names") = indices;
+  speciesIndices.attr("names") = indices;
+  List res = List::create(_["Cohorts"] = cohortIndices, _["Species"] = speciesIndices);
+  res.attr("period") = periodType;
+  return(res);
+}
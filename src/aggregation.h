@@ -0,0 +1,77 @@
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+
+#ifndef AGGREGATION_H
+#define AGGREGATION_H
+using namespace Rcpp;
+
+const int AGGREGATION_SUM = 0;
+const int AGGREGATION_MEAN = 1;
+const int AGGREGATION_MAX = 2;
+const int AGGREGATION_MIN = 3;
+
+/**
+ * In-run temporal aggregation of daily outputs (control parameter 'aggregation').
+ * 
+ * When active, daily outputs are defined with two rows only (see 'outputRows'): the fill 
+ * functions write each day into the first row (and the initial state of the next day into 
+ * the second one), 'addDay' accumulates the first row into its period and shifts the buffer.
+ */
+class TemporalAggregator {
+public:
+  TemporalAggregator(List control, CharacterVector dateStrings, DataFrame cohorts);
+  bool active;
+  int outputRows(int numDays);
+  DataFrame outputFrame(DataFrame meteo);
+  void setBuffer(List buffer);
+  void addDay(int day);
+  List result();
+  
+private:
+  struct Leaf {
+    std::string top, name;
+    SEXP daily;
+    int ncol, ncolOut, fun;
+    bool bySpecies, sumSpecies;
+    std::vector<double> row1, value, count;
+  };
+  List spec, buffer;
+  CharacterVector periodLabels, speciesNames;
+  std::vector<int> dayPeriod, cohortSpecies, periodDays;
+  int nperiods, numCohorts;
+  bool bySpecies;
+  std::vector<Leaf> leaves;
+  SEXP weights;
+  
+  void collectLeaves(SEXP obj, std::string top, std::string name, int depth);
+  int leafFunction(std::string top, std::string name);
+  SEXP buildResult(SEXP obj, std::string top, int depth, size_t& ileaf, CharacterVector rows, IntegerVector keep);
+};
+
+
+/**
+ * In-run drought stress indices (control parameter 'droughtStressPeriod').
+ * 
+ * Daily drought stress and plant (or leaf) water potential of cohorts are accumulated 
+ * into the indices of function droughtStress (NDD, DI, ADS, MDS and WSI) for each period, 
+ * which are returned for cohorts and for species (LAI-weighted) by 'result'.
+ */
+class DroughtStressAccumulator {
+public:
+  DroughtStressAccumulator(List control, CharacterVector dateStrings, DataFrame cohorts);
+  bool active;
+  void addDay(int day, List plants, String transpirationMode);
+  List result();
+  
+private:
+  std::string periodType;
+  CharacterVector periodLabels, cohortNames, speciesNames;
+  std::vector<int> dayPeriod, cohortSpecies, periodDays;
+  int nperiods, numCohorts;
+  std::vector<double> ndays, nstress, nna, ndd, di, sumStress, maxStress, npsi, sumPsi, maxPsi, maxLAI;
+  
+  NumericMatrix indexMatrix(std::string index, IntegerVector keep, bool bySpecies);
+};
+
+#endif
@@ -0,0 +1,77 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <chrono>
+#include "diagnostics.h"
+using namespace Rcpp;
+
+/**
+ * Optional instrumentation of daily simulations (control parameter 'diagnostics').
+ * 
+ * Wall-clock time is accumulated for the main phases of 'spwbDay2' and 'growthDay2', 
+ * and counters are kept for the iterative hydraulic solvers. When disabled, each 
+ * instrumented point reduces to a test on 'diagnosticsEnabled'. Accumulators are 
+ * global and reset at the start of each call to 'spwb' or 'growth'.
+ */
+bool diagnosticsEnabled = false;
+
+static double phaseTime[DIAGNOSTICS_NUM_PHASES];
+static double phaseCalls[DIAGNOSTICS_NUM_PHASES];
+static double counters[DIAGNOSTICS_NUM_COUNTERS];
+
+const char* diagnosticsPhaseNames[] = {"SupplyFunctions", "Photosynthesis", "ProfitMaximization", "Capacitance",
+                                       "EnergyBalance", "SoilFlows", "GrowRing", "PhloemTransport"};
+const char* diagnosticsCounterNames[] = {"NewtonIterations", "NonConvergedBelowground", "NonConvergedXylem", 
+                                         "TruncatedSupplyFunctions", "SolverRetries", "SolverRecovered"};
+
+void resetDiagnostics(bool enabled) {
+  diagnosticsEnabled = enabled;
+  for(int i=0;i<DIAGNOSTICS_NUM_PHASES;i++) {
+    phaseTime[i] = 0.0;
+    phaseCalls[i] = 0.0;
+  }
+  for(int i=0;i<DIAGNOSTICS_NUM_COUNTERS;i++) counters[i] = 0.0;
+}
+
+bool diagnosticsRequested(List control) {
+  if(!control.containsElementNamed("diagnostics")) return(false);
+  return(Rcpp::as<bool>(control["diagnostics"]));
+}
+
+double diagnosticsStart() {
+  if(!diagnosticsEnabled) return(0.0);
+  return(std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void diagnosticsStop(int phase, double start) {
+  if(!diagnosticsEnabled) return;
+  double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  phaseTime[phase] += (now - start);
+  phaseCalls[phase] += 1.0;
+}
+
+void diagnosticsCount(int counter, int n) {
+  if(!diagnosticsEnabled) return;
+  counters[counter] += (double) n;
+}
+
+List diagnosticsList() {
+  NumericVector time(DIAGNOSTICS_NUM_PHASES), calls(DIAGNOSTICS_NUM_PHASES);
+  CharacterVector phases(DIAGNOSTICS_NUM_PHASES);
+  for(int i=0;i<DIAGNOSTICS_NUM_PHASES;i++) {
+    time[i] = phaseTime[i];
+    calls[i] = phaseCalls[i];
+    phases[i] = diagnosticsPhaseNames[i];
+  }
+  time.attr("names") = phases;
+  calls.attr("names") = phases;
+  NumericVector solver(DIAGNOSTICS_NUM_COUNTERS);
+  CharacterVector counterNames(DIAGNOSTICS_NUM_COUNTERS);
+  for(int i=0;i<DIAGNOSTICS_NUM_COUNTERS;i++) {
+    solver[i] = counters[i];
+    counterNames[i] = diagnosticsCounterNames[i];
+  }
+  solver.attr("names") = counterNames;
+  return(List::create(_["Time"] = time, 
+                      _["Calls"] = calls,
+                      _["Solver"] = solver));
+}
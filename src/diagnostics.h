@@ -0,0 +1,36 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+//Timed phases
+const int DIAGNOSTICS_SUPPLY_FUNCTIONS = 0;
+const int DIAGNOSTICS_PHOTOSYNTHESIS = 1;
+const int DIAGNOSTICS_PROFIT_MAXIMIZATION = 2;
+const int DIAGNOSTICS_CAPACITANCE = 3;
+const int DIAGNOSTICS_ENERGY_BALANCE = 4;
+const int DIAGNOSTICS_SOIL_FLOWS = 5;
+const int DIAGNOSTICS_GROW_RING = 6;
+const int DIAGNOSTICS_PHLOEM_TRANSPORT = 7;
+const int DIAGNOSTICS_NUM_PHASES = 8;
+
+//Solver counters
+const int DIAGNOSTICS_NEWTON_ITERATIONS = 0;
+const int DIAGNOSTICS_BELOWGROUND_NONCONVERGED = 1;
+const int DIAGNOSTICS_XYLEM_NONCONVERGED = 2;
+const int DIAGNOSTICS_TRUNCATED_SUPPLY = 3;
+const int DIAGNOSTICS_SOLVER_RETRIES = 4;
+const int DIAGNOSTICS_SOLVER_RECOVERED = 5;
+const int DIAGNOSTICS_NUM_COUNTERS = 6;
+
+extern bool diagnosticsEnabled;
+
+void resetDiagnostics(bool enabled);
+bool diagnosticsRequested(List control);
+double diagnosticsStart();
+void diagnosticsStop(int phase, double start);
+void diagnosticsCount(int counter, int n = 1);
+List diagnosticsList();
+
+#endif
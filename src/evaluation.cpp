@@ -0,0 +1,112 @@
+#include <Rcpp.h>
+#include <cmath>
+#include <vector>
+using namespace Rcpp;
+
+/**
+ * Aggregates a daily series into periods (mean or sum of non-missing values), as 
+ * tapply(x, period, FUN, na.rm = TRUE). Periods without days are returned as missing, 
+ * and so are means of periods without non-missing values, whereas their sums are zero.
+ */
+std::vector<double> periodValues(NumericVector x, IntegerVector period, int numPeriods, bool periodSums) {
+  std::vector<double> s(numPeriods, 0.0);
+  std::vector<int> n(numPeriods, 0), ndays(numPeriods, 0);
+  int nd = std::min(x.size(), period.size());
+  for(int d=0;d<nd;d++) {
+    int p = period[d];
+    if(p==NA_INTEGER || p<1 || p>numPeriods) continue;
+    ndays[p-1]++;
+    if(!NumericVector::is_na(x[d])) {
+      s[p-1] += x[d];
+      n[p-1]++;
+    }
+  }
+  for(int p=0;p<numPeriods;p++) {
+    if(ndays[p]==0) s[p] = NA_REAL;
+    else if(!periodSums) s[p] = (n[p]==0 ? NA_REAL : s[p]/((double) n[p]));
+  }
+  return(s);
+}
+
+/**
+ * Evaluation statistics of modelled against observed values. Observations must be already
+ * aligned with the simulated days (missing values where no observation is available).
+ * If 'period' is supplied, both series are first aggregated into 'numPeriods' periods
+ * (sums if 'periodSums = true', means otherwise). All statistics are calculated on
+ * pairs where both observed and modelled values are available.
+ */
+// [[Rcpp::export(".evaluationStatistics")]]
+NumericVector evaluationStatistics(NumericVector observed, NumericVector modelled,
+                                   IntegerVector period = IntegerVector::create(), int numPeriods = 0,
+                                   bool periodSums = false) {
+  if(observed.size()!=modelled.size()) stop("Vectors 'observed' and 'modelled' should have the same length.");
+  std::vector<double> obs, pred;
+  if(period.size()>0) {
+    if(period.size()!=observed.size()) stop("Vector 'period' should have the same length as 'observed'.");
+    obs = periodValues(observed, period, numPeriods, periodSums);
+    pred = periodValues(modelled, period, numPeriods, periodSums);
+  } else {
+    obs = std::vector<double>(observed.begin(), observed.end());
+    pred = std::vector<double>(modelled.begin(), modelled.end());
+  }
+  //First pass: means and errors
+  int n = 0;
+  double sumObs = 0.0, sumPred = 0.0, sumE = 0.0, sumAbsE = 0.0, sumSqE = 0.0;
+  for(size_t i=0;i<obs.size();i++) {
+    if(NumericVector::is_na(obs[i]) || NumericVector::is_na(pred[i])) continue;
+    double e = pred[i] - obs[i];
+    sumObs += obs[i];
+    sumPred += pred[i];
+    sumE += e;
+    sumAbsE += std::abs(e);
+    sumSqE += e*e;
+    n++;
+  }
+  double Bias = NA_REAL, MAE = NA_REAL, r = NA_REAL, NSE = NA_REAL, NSEabs = NA_REAL, loglik = NA_REAL;
+  if(n>0) {
+    double meanObs = sumObs/((double) n);
+    double meanPred = sumPred/((double) n);
+    Bias = sumE/((double) n);
+    MAE = sumAbsE/((double) n);
+    //Second pass: deviations from means
+    double ssObs = 0.0, ssPred = 0.0, spOP = 0.0, sumAbsDevObs = 0.0;
+    for(size_t i=0;i<obs.size();i++) {
+      if(NumericVector::is_na(obs[i]) || NumericVector::is_na(pred[i])) continue;
+      double dObs = obs[i] - meanObs;
+      double dPred = pred[i] - meanPred;
+      ssObs += dObs*dObs;
+      ssPred += dPred*dPred;
+      spOP += dObs*dPred;
+      sumAbsDevObs += std::abs(dObs);
+    }
+    if(ssObs>0.0) {
+      NSE = 1.0 - (sumSqE/ssObs);
+      NSEabs = 1.0 - (sumAbsE/sumAbsDevObs);
+      if(ssPred>0.0) r = spOP/sqrt(ssObs*ssPred);
+    }
+    //Gaussian log-likelihood of complete pairs, using the standard deviation of all observations
+    //(including those without prediction)
+    int nAll = 0;
+    double sumAll = 0.0;
+    for(size_t i=0;i<obs.size();i++) {
+      if(NumericVector::is_na(obs[i])) continue;
+      sumAll += obs[i];
+      nAll++;
+    }
+    double meanAll = sumAll/((double) nAll);
+    double ssAll = 0.0;
+    for(size_t i=0;i<obs.size();i++) {
+      if(NumericVector::is_na(obs[i])) continue;
+      ssAll += (obs[i] - meanAll)*(obs[i] - meanAll);
+    }
+    if(nAll>1 && ssAll>0.0) {
+      double sd = sqrt(ssAll/((double) (nAll-1)));
+      loglik = - ((double) n)*(0.5*log(2.0*M_PI) + log(sd)) - 0.5*sumSqE/(sd*sd);
+    }
+  }
+  double R2 = (NumericVector::is_na(r) ? NA_REAL : r*r);
+  NumericVector res = NumericVector::create(_["n"] = (double) n, _["Bias"] = Bias, _["MAE"] = MAE,
+                                            _["r"] = r, _["R2"] = R2, _["NSE"] = NSE,
+                                            _["NSEabs"] = NSEabs, _["loglikelihood"] = loglik);
+  return(res);
+}
@@ -0,0 +1,513 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "forestutils.h"
+#include "paramutils.h"
+using namespace Rcpp;
+
+/**
+ * Utilities to remove, add or replace plant cohorts in growth input objects (used by fordyn)
+ * without going through data frame subsetting in R. All per-cohort structures (data frames,
+ * 'belowLayers' matrices and ring list) are processed in a single pass.
+ * 
+ * The growth input of the next year is still built by 'growthInput' from the whole stand, because
+ * canopy layers, horizontal root overlap and the state of static shrubs depend on all cohorts jointly.
+ * These utilities only transfer the state of surviving cohorts into it; there is no growable native
+ * cohort store.
+ */
+const char* cohortDataFrameNames[] = {"cohorts", "above", "below",
+                                      "paramsPhenology", "paramsAnatomy", "paramsInterception",
+                                      "paramsTranspiration", "paramsWaterStorage", "paramsGrowth",
+                                      "paramsAllometries", "internalPhenology", "internalWater",
+                                      "internalCarbon", "internalAllocation", "internalMortality"};
+
+IntegerVector whichTrue(LogicalVector sel) {
+  std::vector<int> w;
+  for(int i=0;i<sel.size();i++) if(sel[i]==TRUE) w.push_back(i);
+  IntegerVector rows(w.size());
+  for(size_t i=0;i<w.size();i++) rows[i] = w[i];
+  return(rows);
+}
+
+SEXP subsetVectorElements(SEXP v, IntegerVector rows) {
+  int n = rows.size();
+  if(TYPEOF(v)==REALSXP) {
+    NumericVector x = v;
+    NumericVector xs(n);
+    for(int i=0;i<n;i++) xs[i] = x[rows[i]];
+    return(xs);
+  } else if(TYPEOF(v)==INTSXP) {
+    IntegerVector x = v;
+    IntegerVector xs(n);
+    for(int i=0;i<n;i++) xs[i] = x[rows[i]];
+    if(x.hasAttribute("levels")) {
+      xs.attr("levels") = x.attr("levels");
+      xs.attr("class") = x.attr("class");
+    }
+    return(xs);
+  } else if(TYPEOF(v)==LGLSXP) {
+    LogicalVector x = v;
+    LogicalVector xs(n);
+    for(int i=0;i<n;i++) xs[i] = x[rows[i]];
+    return(xs);
+  } else if(TYPEOF(v)==STRSXP) {
+    CharacterVector x = v;
+    CharacterVector xs(n);
+    for(int i=0;i<n;i++) xs[i] = x[rows[i]];
+    return(xs);
+  } else if(TYPEOF(v)==VECSXP) {
+    List x = v;
+    List xs(n);
+    for(int i=0;i<n;i++) xs[i] = x[rows[i]];
+    return(xs);
+  }
+  stop("Unsupported vector type in cohort subsetting");
+}
+
+void copyVectorElements(SEXP to, IntegerVector toRows, SEXP from, IntegerVector fromRows) {
+  int n = toRows.size();
+  if(TYPEOF(to)==REALSXP) {
+    //Integer or logical values are coerced
+    NumericVector x = to;
+    NumericVector y = Rcpp::as<Rcpp::NumericVector>(from);
+    for(int i=0;i<n;i++) x[toRows[i]] = y[fromRows[i]];
+    return;
+  }
+  if(TYPEOF(to)!=TYPEOF(from)) stop("Incompatible vector types in cohort replacement");
+  if(TYPEOF(to)==INTSXP) {
+    IntegerVector x = to, y = from;
+    for(int i=0;i<n;i++) x[toRows[i]] = y[fromRows[i]];
+  } else if(TYPEOF(to)==LGLSXP) {
+    LogicalVector x = to, y = from;
+    for(int i=0;i<n;i++) x[toRows[i]] = y[fromRows[i]];
+  } else if(TYPEOF(to)==STRSXP) {
+    CharacterVector x = to, y = from;
+    for(int i=0;i<n;i++) x[toRows[i]] = y[fromRows[i]];
+  } else if(TYPEOF(to)==VECSXP) {
+    List x = to, y = from;
+    for(int i=0;i<n;i++) x[toRows[i]] = y[fromRows[i]];
+  } else {
+    stop("Unsupported vector type in cohort replacement");
+  }
+}
+
+DataFrame subsetDataFrameRows(DataFrame df, IntegerVector rows) {
+  int ncol = df.size();
+  List out(ncol);
+  for(int j=0;j<ncol;j++) {
+    SEXP col = df[j];
+    out[j] = subsetVectorElements(col, rows);
+  }
+  out.attr("names") = df.attr("names");
+  SEXP rn = df.attr("row.names");
+  if(TYPEOF(rn)==STRSXP) out.attr("row.names") = subsetVectorElements(rn, rows);
+  else {
+    IntegerVector rowNumbers(rows.size());
+    for(int i=0;i<rows.size();i++) rowNumbers[i] = i+1;
+    out.attr("row.names") = rowNumbers;
+  }
+  out.attr("class") = df.attr("class");
+  return(Rcpp::as<Rcpp::DataFrame>(out));
+}
+
+void copyDataFrameRows(DataFrame to, IntegerVector toRows, DataFrame from, IntegerVector fromRows) {
+  if(to.size()!=from.size()) stop("Data frames with different number of columns in cohort replacement");
+  for(int j=0;j<to.size();j++) {
+    SEXP colTo = to[j];
+    SEXP colFrom = from[j];
+    copyVectorElements(colTo, toRows, colFrom, fromRows);
+  }
+}
+
+NumericMatrix subsetMatrixRows(NumericMatrix m, IntegerVector rows) {
+  int n = rows.size();
+  NumericMatrix ms(n, m.ncol());
+  for(int i=0;i<n;i++) ms(i,_) = m(rows[i],_);
+  if(m.hasAttribute("dimnames")) {
+    List dn = m.attr("dimnames");
+    List dns(2);
+    if(!Rf_isNull(dn[0])) dns[0] = subsetVectorElements(dn[0], rows);
+    dns[1] = dn[1];
+    ms.attr("dimnames") = dns;
+  }
+  return(ms);
+}
+
+void copyMatrixRows(NumericMatrix to, IntegerVector toRows, NumericMatrix from, IntegerVector fromRows) {
+  if(to.ncol()!=from.ncol()) stop("Matrices with different number of columns in cohort replacement");
+  for(int i=0;i<toRows.size();i++) to(toRows[i],_) = from(fromRows[i],_);
+}
+
+bool isCohortMatrix(SEXP m, int numCohorts) {
+  if(TYPEOF(m)!=REALSXP) return(false);
+  NumericVector v = m;
+  if(!v.hasAttribute("dim")) return(false);
+  NumericMatrix mat(m);
+  return(mat.nrow()==numCohorts);
+}
+
+/**
+ * Returns a (shallow) copy of growth input 'x' with cohorts in 'rows' (0-based) only.
+ * Elements that are not cohort-specific are shared with 'x'.
+ */
+List subsetInputCohorts(List x, IntegerVector rows) {
+  DataFrame above = Rcpp::as<Rcpp::DataFrame>(x["above"]);
+  int numCohorts = above.nrow();
+  List out(x.size());
+  for(int i=0;i<x.size();i++) out[i] = x[i];
+  out.attr("names") = x.attr("names");
+  out.attr("class") = x.attr("class");
+  for(const char* name : cohortDataFrameNames) {
+    if(x.containsElementNamed(name)) {
+      int idx = x.findName(name);
+      out[idx] = subsetDataFrameRows(Rcpp::as<Rcpp::DataFrame>(x[idx]), rows);
+    }
+  }
+  if(x.containsElementNamed("belowLayers")) {
+    List belowLayers = x["belowLayers"];
+    List belowLayersOut(belowLayers.size());
+    for(int l=0;l<belowLayers.size();l++) {
+      SEXP m = belowLayers[l];
+      if(isCohortMatrix(m, numCohorts)) belowLayersOut[l] = subsetMatrixRows(NumericMatrix(m), rows);
+      else belowLayersOut[l] = m;
+    }
+    belowLayersOut.attr("names") = belowLayers.attr("names");
+    out["belowLayers"] = belowLayersOut;
+  }
+  if(x.containsElementNamed("internalRings")) {
+    List rings = x["internalRings"];
+    List ringsOut = subsetVectorElements(rings, rows);
+    if(rings.hasAttribute("names")) ringsOut.attr("names") = subsetVectorElements(rings.attr("names"), rows);
+    out["internalRings"] = ringsOut;
+  }
+  return(out);
+}
+
+/**
+ * Copies the state of cohorts 'fromRows' of 'from' into cohorts 'toRows' of 'to' (0-based),
+ * modifying 'to' in place. Both objects should have been built with the same control options.
+ * Mortality ('internalMortality') is accumulated during each simulation and is not carried over,
+ * so that dead plants of a year are not counted again in the following years.
+ */
+void replaceInputCohorts(List to, IntegerVector toRows, List from, IntegerVector fromRows) {
+  if(toRows.size()!=fromRows.size()) stop("Different number of cohorts to replace");
+  if(toRows.size()==0) return;
+  DataFrame aboveTo = Rcpp::as<Rcpp::DataFrame>(to["above"]);
+  DataFrame aboveFrom = Rcpp::as<Rcpp::DataFrame>(from["above"]);
+  int numCohortsTo = aboveTo.nrow();
+  int numCohortsFrom = aboveFrom.nrow();
+  for(const char* name : cohortDataFrameNames) {
+    if(strcmp(name, "internalMortality")==0) continue;
+    if(to.containsElementNamed(name) && from.containsElementNamed(name)) {
+      copyDataFrameRows(Rcpp::as<Rcpp::DataFrame>(to[name]), toRows,
+                        Rcpp::as<Rcpp::DataFrame>(from[name]), fromRows);
+    }
+  }
+  if(to.containsElementNamed("belowLayers") && from.containsElementNamed("belowLayers")) {
+    List belowLayersTo = to["belowLayers"];
+    List belowLayersFrom = from["belowLayers"];
+    CharacterVector layerNames = belowLayersTo.names();
+    for(int l=0;l<belowLayersTo.size();l++) {
+      std::string layerName = as<std::string>(layerNames[l]);
+      if(!belowLayersFrom.containsElementNamed(layerName.c_str())) continue;
+      SEXP mTo = belowLayersTo[l];
+      SEXP mFrom = belowLayersFrom[layerName];
+      if(isCohortMatrix(mTo, numCohortsTo) && isCohortMatrix(mFrom, numCohortsFrom)) {
+        copyMatrixRows(NumericMatrix(mTo), toRows, NumericMatrix(mFrom), fromRows);
+      }
+    }
+  }
+  if(to.containsElementNamed("internalRings") && from.containsElementNamed("internalRings")) {
+    List ringsTo = to["internalRings"];
+    List ringsFrom = from["internalRings"];
+    copyVectorElements(ringsTo, toRows, ringsFrom, fromRows);
+  }
+}
+
+// [[Rcpp::export(".removeCohorts")]]
+List removeCohorts(List x, LogicalVector remove) {
+  LogicalVector keep(remove.size());
+  for(int i=0;i<remove.size();i++) keep[i] = (remove[i]!=TRUE);
+  return(subsetInputCohorts(x, whichTrue(keep)));
+}
+
+// [[Rcpp::export(".replaceCohorts")]]
+void replaceCohorts(List to, LogicalVector replace, List from, LogicalVector select) {
+  replaceInputCohorts(to, whichTrue(replace), from, whichTrue(select));
+}
+
+/**
+ * Light-limited recruitment (MED mode). Recruit density (trees) or cover (shrubs) of selected 
+ * species is increased in steps of 'recrStepN' individuals per hectare, as long as the light
+ * reaching the ground remains above the species threshold and maximum recruitment is not reached.
+ * 
+ * Species parameters, the leaf area of existing shrubs and the basal area of larger existing 
+ * trees are calculated once, so that each step only updates the contribution of recruits to the 
+ * extinction profile (sum of kPAR x LAI) at ground level.
+ */
+double groundPARRecruitment(NumericVector kt, NumericVector SLAt, 
+                            NumericVector afbt, NumericVector bfbt, NumericVector cfbt, NumericVector dfbt,
+                            NumericVector Nt, NumericVector DBHt, NumericVector ltbaExisting, 
+                            int ntreeExisting, int ntree, double kLAIShrubs) {
+  NumericVector BA = treeBasalArea(Nt, DBHt);
+  double s = kLAIShrubs;
+  for(int i=0;i<ntree;i++) {
+    //Larger tree basal area: existing trees (fixed) plus recruits
+    double ltba = ltbaExisting[i];
+    for(int j=ntreeExisting;j<ntree;j++) {
+      if(i==j) ltba += BA[j]/2.0;
+      else if(DBHt[j]>DBHt[i]) ltba += BA[j];
+    }
+    double lb = ((Nt[i]/10000)*afbt[i]*pow(DBHt[i], bfbt[i])*exp(cfbt[i]*ltba)*pow(DBHt[i], dfbt[i]*ltba));
+    s += kt[i]*SLAt[i]*lb;
+  }
+  //Proportion of leaf area above ground level (the same for all cohorts)
+  double p = std::min(1.0, leafAreaProportion(0.0, 1.0, 0.0, 1.0));
+  return(100*exp((-1)*p*s));
+}
+
+// [[Rcpp::export(".recruitmentLightLimited")]]
+List recruitmentLightLimited(List forest, List recr_forest, DataFrame SpParams,
+                             LogicalVector tree_selection, NumericVector tree_minFPAR, NumericVector tree_maxN,
+                             LogicalVector shrub_selection, NumericVector shrub_minFPAR, NumericVector shrub_maxCover,
+                             double recrStepN = 10.0) {
+  DataFrame treeData = Rcpp::as<Rcpp::DataFrame>(forest["treeData"]);
+  DataFrame shrubData = Rcpp::as<Rcpp::DataFrame>(forest["shrubData"]);
+  DataFrame recrTreeData = Rcpp::as<Rcpp::DataFrame>(recr_forest["treeData"]);
+  DataFrame recrShrubData = Rcpp::as<Rcpp::DataFrame>(recr_forest["shrubData"]);
+  int ntreeExisting = treeData.nrow(), nshrubExisting = shrubData.nrow();
+  int ntreeRecr = recrTreeData.nrow(), nshrubRecr = recrShrubData.nrow();
+  int ntree = ntreeExisting + ntreeRecr;
+  
+  //Tree cohorts (existing first, then recruits) in contiguous arrays
+  IntegerVector SPt(ntree);
+  NumericVector Nt(ntree), DBHt(ntree);
+  IntegerVector treeSP = Rcpp::as<Rcpp::IntegerVector>(treeData["Species"]);
+  NumericVector treeN = treeData["N"], treeDBH = treeData["DBH"];
+  IntegerVector recrTreeSP = Rcpp::as<Rcpp::IntegerVector>(recrTreeData["Species"]);
+  NumericVector recrTreeN = clone(Rcpp::as<Rcpp::NumericVector>(recrTreeData["N"]));
+  NumericVector recrTreeDBH = recrTreeData["DBH"];
+  for(int i=0;i<ntreeExisting;i++) {
+    SPt[i] = treeSP[i];
+    Nt[i] = treeN[i];
+    DBHt[i] = treeDBH[i];
+  }
+  for(int i=0;i<ntreeRecr;i++) {
+    SPt[ntreeExisting+i] = recrTreeSP[i];
+    Nt[ntreeExisting+i] = recrTreeN[i];
+    DBHt[ntreeExisting+i] = recrTreeDBH[i];
+  }
+  NumericVector kt = speciesNumericParameterWithImputation(SPt, SpParams, "kPAR", true);
+  NumericVector SLAt = speciesNumericParameterWithImputation(SPt, SpParams, "SLA", true);
+  NumericVector afbt = speciesNumericParameterWithImputation(SPt, SpParams, "a_fbt", true);
+  NumericVector bfbt = speciesNumericParameterWithImputation(SPt, SpParams, "b_fbt", true);
+  NumericVector cfbt = speciesNumericParameterWithImputation(SPt, SpParams, "c_fbt", true);
+  NumericVector dfbt = speciesNumericParameterWithImputation(SPt, SpParams, "d_fbt", true);
+  NumericVector BAExisting = treeBasalArea(Nt, DBHt);
+  NumericVector ltbaExisting(ntree, 0.0);
+  for(int i=0;i<ntree;i++) {
+    for(int j=0;j<ntreeExisting;j++) {
+      if(i==j) ltbaExisting[i] += BAExisting[j]/2.0;
+      else if(DBHt[j]>DBHt[i]) ltbaExisting[i] += BAExisting[j];
+    }
+  }
+  
+  //Shrub leaf area: fixed for existing shrubs and proportional to cover for recruits
+  double kLAIShrubsExisting = 0.0;
+  if(nshrubExisting>0) {
+    IntegerVector shrubSP = Rcpp::as<Rcpp::IntegerVector>(shrubData["Species"]);
+    NumericVector shrubLAI = shrubLAIMED(shrubSP, shrubData["Cover"], shrubData["Height"], SpParams);
+    NumericVector ks = speciesNumericParameterWithImputation(shrubSP, SpParams, "kPAR", true);
+    for(int i=0;i<nshrubExisting;i++) kLAIShrubsExisting += ks[i]*shrubLAI[i];
+  }
+  IntegerVector recrShrubSP = Rcpp::as<Rcpp::IntegerVector>(recrShrubData["Species"]);
+  NumericVector recrShrubHeight = recrShrubData["Height"];
+  NumericVector recrShrubCover = clone(Rcpp::as<Rcpp::NumericVector>(recrShrubData["Cover"]));
+  NumericVector unitCover(nshrubRecr, 1.0);
+  NumericVector recrShrubArea = shrubIndividualAreaMED(recrShrubSP, unitCover, recrShrubHeight, SpParams);
+  NumericVector recrShrubLAIUnit = shrubLAIMED(recrShrubSP, unitCover, recrShrubHeight, SpParams);
+  NumericVector recrShrubK = speciesNumericParameterWithImputation(recrShrubSP, SpParams, "kPAR", true);
+  
+  //Light at ground level without recruits
+  double PARperc = 100.0;
+  if((ntreeExisting+nshrubExisting)>0) {
+    PARperc = groundPARRecruitment(kt, SLAt, afbt, bfbt, cfbt, dfbt, Nt, DBHt, ltbaExisting, 
+                                   ntreeExisting, ntreeExisting, kLAIShrubsExisting);
+  }
+  LogicalVector tsel = clone(tree_selection), ssel = clone(shrub_selection);
+  for(int i=0;i<ntreeRecr;i++) tsel[i] = tsel[i] && (PARperc > tree_minFPAR[i]);
+  for(int i=0;i<nshrubRecr;i++) ssel[i] = ssel[i] && (PARperc > shrub_minFPAR[i]);
+  
+  bool anySelected = (is_true(any(tsel)) || is_true(any(ssel)));
+  while(anySelected) {
+    for(int i=0;i<ntreeRecr;i++) {
+      if(tsel[i]) {
+        recrTreeN[i] += recrStepN;
+        Nt[ntreeExisting+i] = recrTreeN[i];
+      }
+    }
+    for(int i=0;i<nshrubRecr;i++) {
+      if(ssel[i]) {
+        double iniN = 10000.0*(recrShrubCover[i]/(100.0*recrShrubArea[i]));
+        double coverNew = std::min(shrub_maxCover[i], (iniN + recrStepN)*recrShrubArea[i]/100.0);
+        //Cover cannot increase (e.g. zero individual area)
+        if(!(coverNew > recrShrubCover[i])) ssel[i] = false;
+        recrShrubCover[i] = coverNew;
+      }
+    }
+    double kLAIShrubs = kLAIShrubsExisting;
+    for(int i=0;i<nshrubRecr;i++) kLAIShrubs += recrShrubK[i]*recrShrubLAIUnit[i]*recrShrubCover[i];
+    PARperc = groundPARRecruitment(kt, SLAt, afbt, bfbt, cfbt, dfbt, Nt, DBHt, ltbaExisting, 
+                                   ntreeExisting, ntree, kLAIShrubs);
+    anySelected = false;
+    for(int i=0;i<ntreeRecr;i++) {
+      tsel[i] = tsel[i] && (PARperc > tree_minFPAR[i]) && (recrTreeN[i] < tree_maxN[i]);
+      anySelected = anySelected || tsel[i];
+    }
+    for(int i=0;i<nshrubRecr;i++) {
+      ssel[i] = ssel[i] && (PARperc > shrub_minFPAR[i]) && (recrShrubCover[i] < shrub_maxCover[i]);
+      anySelected = anySelected || ssel[i];
+    }
+  }
+  return(List::create(_["N"] = recrTreeN, _["Cover"] = recrShrubCover, _["PARground"] = PARperc));
+}
+
+/**
+ * Cohort compaction. Cohorts of the same species (and growth form) whose height 
+ * (and DBH, for trees) differ from that of a reference cohort less than the given tolerances 
+ * are merged into the reference cohort. Density, cover, leaf area and mortality are summed, 
+ * DBH is averaged so that basal area is conserved, water and leaf carbon states are averaged 
+ * weighting by leaf area, sapwood carbon states by sapwood area and the remaining 
+ * per-individual variables by density. Ring records of the reference cohort are kept.
+ */
+const char* cohortSumColumns[] = {"N", "Cover", "LAI_live", "LAI_expanded", "LAI_dead"};
+
+double weightedMean(NumericVector v, std::vector<int>& members, std::vector<double>& w) {
+  double s = 0.0, sw = 0.0;
+  for(size_t m=0;m<members.size();m++) {
+    s += w[m]*v[members[m]];
+    sw += w[m];
+  }
+  if(sw > 0.0) return(s/sw);
+  //Equal weights if weights are all zero
+  s = 0.0;
+  for(size_t m=0;m<members.size();m++) s += v[members[m]];
+  return(s/((double) members.size()));
+}
+
+void mergeColumnRows(NumericVector v, std::string colName, int target, std::vector<int>& members, 
+                     std::vector<double>& w, bool sumColumn) {
+  for(const char* sc : cohortSumColumns) if(colName == sc) sumColumn = true;
+  if(sumColumn) {
+    double s = 0.0;
+    for(size_t m=0;m<members.size();m++) s += v[members[m]];
+    v[target] = s;
+  } else if(colName == "DBH") {
+    if(NumericVector::is_na(v[target])) return; //Shrubs
+    //Quadratic mean diameter (conserves basal area)
+    double s = 0.0, sw = 0.0;
+    for(size_t m=0;m<members.size();m++) {
+      s += w[m]*pow(v[members[m]], 2.0);
+      sw += w[m];
+    }
+    if(sw > 0.0) v[target] = sqrt(s/sw);
+  } else {
+    v[target] = weightedMean(v, members, w);
+  }
+}
+
+void mergeDataFrameRows(DataFrame df, int target, std::vector<int>& members, 
+                        std::vector<double>& w, bool sumAll) {
+  CharacterVector colNames = df.names();
+  for(int j=0;j<df.size();j++) {
+    SEXP col = df[j];
+    if(TYPEOF(col)!=REALSXP) continue; //Integer, logical and character columns are kept from target
+    mergeColumnRows(NumericVector(col), as<std::string>(colNames[j]), target, members, w, sumAll);
+  }
+}
+
+// [[Rcpp::export(".mergeCohorts")]]
+List mergeCohorts(List x, double dbhTolerance, double heightTolerance, bool mergeShrubs = true) {
+  List xm = clone(x);
+  DataFrame above = Rcpp::as<Rcpp::DataFrame>(xm["above"]);
+  IntegerVector SP = above["SP"];
+  NumericVector N = above["N"];
+  NumericVector DBH = above["DBH"];
+  NumericVector H = above["H"];
+  NumericVector SA = above["SA"];
+  NumericVector LAI_live = above["LAI_live"];
+  int numCohorts = SP.size();
+  
+  //Assign cohorts to reference cohorts
+  IntegerVector target(numCohorts);
+  for(int i=0;i<numCohorts;i++) target[i] = i;
+  for(int i=0;i<numCohorts;i++) {
+    if(target[i]!=i) continue;
+    bool isTree = !NumericVector::is_na(DBH[i]);
+    if(!isTree && !mergeShrubs) continue;
+    for(int j=i+1;j<numCohorts;j++) {
+      if((target[j]!=j) || (SP[j]!=SP[i])) continue;
+      if(isTree != (!NumericVector::is_na(DBH[j]))) continue;
+      if(std::abs(H[j] - H[i]) > heightTolerance) continue;
+      if(isTree && (std::abs(DBH[j] - DBH[i]) > dbhTolerance)) continue;
+      target[j] = i;
+    }
+  }
+  
+  LogicalVector keep(numCohorts, true);
+  for(int i=0;i<numCohorts;i++) {
+    std::vector<int> members;
+    for(int j=i;j<numCohorts;j++) if(target[j]==i) members.push_back(j);
+    if(members.size() < 2) continue;
+    for(size_t m=1;m<members.size();m++) keep[members[m]] = false;
+    std::vector<double> wN(members.size()), wLAI(members.size()), wSA(members.size());
+    for(size_t m=0;m<members.size();m++) {
+      int c = members[m];
+      wN[m] = N[c];
+      wLAI[m] = LAI_live[c];
+      wSA[m] = N[c]*SA[c];
+    }
+    for(const char* name : cohortDataFrameNames) {
+      if(!xm.containsElementNamed(name)) continue;
+      std::string dfName = name;
+      if(dfName == "above") continue;
+      DataFrame df = Rcpp::as<Rcpp::DataFrame>(xm[name]);
+      if(dfName == "internalWater") {
+        mergeDataFrameRows(df, i, members, wLAI, false);
+      } else if(dfName == "internalCarbon") {
+        //Leaf compartments weighted by leaf area, other compartments by sapwood area
+        CharacterVector colNames = df.names();
+        for(int j=0;j<df.size();j++) {
+          SEXP col = df[j];
+          if(TYPEOF(col)!=REALSXP) continue;
+          std::string colName = as<std::string>(colNames[j]);
+          bool leafColumn = (colName.size() >= 4) && (colName.compare(colName.size()-4, 4, "Leaf")==0);
+          mergeColumnRows(NumericVector(col), colName, i, members, (leafColumn ? wLAI : wSA), false);
+        }
+      } else {
+        mergeDataFrameRows(df, i, members, wN, (dfName == "internalMortality"));
+      }
+    }
+    if(xm.containsElementNamed("belowLayers")) {
+      List belowLayers = xm["belowLayers"];
+      CharacterVector layerNames = belowLayers.names();
+      for(int l=0;l<belowLayers.size();l++) {
+        SEXP mat = belowLayers[l];
+        if(!isCohortMatrix(mat, numCohorts)) continue;
+        NumericMatrix M(mat);
+        std::string layerName = as<std::string>(layerNames[l]);
+        std::vector<double>& w = ((layerName == "V") || (layerName == "L")) ? wN : wLAI;
+        for(int k=0;k<M.ncol();k++) {
+          NumericVector colk = M(_,k);
+          M(i,k) = weightedMean(colk, members, w);
+        }
+      }
+    }
+    mergeDataFrameRows(above, i, members, wN, false);
+  }
+  return(List::create(_["input"] = subsetInputCohorts(xm, whichTrue(keep)),
+                      _["keep"] = keep));
+}
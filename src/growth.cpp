@@ -14,9 +14,37 @@
 #include "woodformation.h"
 #include "soil.h"
 #include "spwb.h"
+#include "meteoforcing.h"
+#include "progress.h"
+#include "diagnostics.h"
+#include "aggregation.h"
 #include <meteoland.h>
 using namespace Rcpp;
 
+const int MORTALITY_WHOLECOHORT_DETERMINISTIC = 0;
+const int MORTALITY_WHOLECOHORT_STOCHASTIC = 1;
+const int MORTALITY_DENSITY_DETERMINISTIC = 2;
+const int MORTALITY_DENSITY_STOCHASTIC = 3;
+const int ALLOCATION_PLANT_KMAX = 0;
+const int ALLOCATION_AL2AS = 1;
+
+/**
+ * Codes of the 'mortalityMode' and 'allocationStrategy' control parameters, parsed once per call 
+ * (-1 for unrecognized values, which match none of the options as before)
+ */
+int mortalityModeCode(String mortalityMode) {
+  if(mortalityMode=="whole-cohort/deterministic") return(MORTALITY_WHOLECOHORT_DETERMINISTIC);
+  else if(mortalityMode=="whole-cohort/stochastic") return(MORTALITY_WHOLECOHORT_STOCHASTIC);
+  else if(mortalityMode=="density/deterministic") return(MORTALITY_DENSITY_DETERMINISTIC);
+  else if(mortalityMode=="density/stochastic") return(MORTALITY_DENSITY_STOCHASTIC);
+  return(-1);
+}
+int allocationStrategyCode(String allocationStrategy) {
+  if(allocationStrategy=="Plant_kmax") return(ALLOCATION_PLANT_KMAX);
+  else if(allocationStrategy=="Al2As") return(ALLOCATION_AL2AS);
+  return(-1);
+}
+
 // [[Rcpp::export("mortality_dailyProbability")]]
 double dailyMortalityProbability(double basalMortalityRate, double stressValue, double stressThreshold,
                                  double minValue = 0.0, double exponent=10.0) {
@@ -323,7 +351,7 @@ List growthDay1(List x, NumericVector meteovec,
   List control = x["control"];  
   
   String soilFunctions = control["soilFunctions"];
-  String mortalityMode = control["mortalityMode"];
+  int mortalityMode = mortalityModeCode(Rcpp::as<String>(control["mortalityMode"]));
   double mortalityBaselineRate = control["mortalityBaselineRate"];
   double mortalityRelativeSugarThreshold= control["mortalityRelativeSugarThreshold"];
   double mortalityRWCThreshold= control["mortalityRWCThreshold"];
@@ -332,8 +360,9 @@ List growthDay1(List x, NumericVector meteovec,
   bool allowDefoliation = control["allowDefoliation"];
   bool sinkLimitation = control["sinkLimitation"];
   bool shrubDynamics = control["shrubDynamics"];
-  String allocationStrategy = control["allocationStrategy"];
+  int allocationStrategy = allocationStrategyCode(Rcpp::as<String>(control["allocationStrategy"]));
   String cavitationRefill = control["cavitationRefill"];
+  bool growthRefill = (cavitationRefill=="growth");
   bool plantWaterPools = control["plantWaterPools"];
   double nonSugarConcentration = control["nonSugarConcentration"];
   List equilibriumOsmoticConcentration  = control["equilibriumOsmoticConcentration"];
@@ -699,7 +728,7 @@ List growthDay1(List x, NumericVector meteovec,
         Al2As[j] = (LAlive)/(SA[j]/10000.0);
       }
       //Decrease PLC due to new SA growth
-      if(cavitationRefill=="growth") StemPLC[j] = std::max(0.0, StemPLC[j] - (deltaSAgrowth[j]/SA[j]));
+      if(growthRefill) StemPLC[j] = std::max(0.0, StemPLC[j] - (deltaSAgrowth[j]/SA[j]));
       
       
       
@@ -715,7 +744,7 @@ List growthDay1(List x, NumericVector meteovec,
       if((!shrubDynamics) & isShrub) dynamicCohort = false;
       double stemSympRWC = symplasticRelativeWaterContent(PlantPsi[j], StemPI0[j], StemEPS[j]);
       if(dynamicCohort) {
-        if(mortalityMode=="whole-cohort/deterministic") {
+        if(mortalityMode==MORTALITY_WHOLECOHORT_DETERMINISTIC) {
           if((sugarSapwood[j]<mortalitySugarThreshold) & allowStarvation) {
             Ndead_day = N[j];
             if(verbose) Rcout<<" [Cohort "<< j<<" died from starvation] ";
@@ -729,9 +758,9 @@ List growthDay1(List x, NumericVector meteovec,
           if(allowDessication) dessicationRate[j] = dailyMortalityProbability(basalMortalityRate, stemSympRWC, mortalityRWCThreshold, 0.0);
           mortalityRate[j] = max(NumericVector::create(basalMortalityRate, dessicationRate[j],  starvationRate[j]));
           
-          if(mortalityMode =="density/deterministic") {
+          if(mortalityMode==MORTALITY_DENSITY_DETERMINISTIC) {
             Ndead_day = N[j]*mortalityRate[j];
-          } else if(mortalityMode =="whole-cohort/stochastic") {
+          } else if(mortalityMode==MORTALITY_WHOLECOHORT_STOCHASTIC) {
             if(R::runif(0.0,1.0) < mortalityRate[j]) {
               Ndead_day = N[j];
               if(dessicationRate[j]>starvationRate[j]) {
@@ -740,7 +769,7 @@ List growthDay1(List x, NumericVector meteovec,
                 Rcout<<" [Cohort "<< j<<" died from starvation] ";
               }
             }
-          } else if(mortalityMode == "density/stochastic") {
+          } else if(mortalityMode==MORTALITY_DENSITY_STOCHASTIC) {
             Ndead_day = R::rbinom(round(N[j]), mortalityRate[j]);
             // Rcout<< j<< " "<< P_day<< " "<< N[j]<< " "<< Ndead_day<< " "<< R::rbinom(750, 2.82309e-05)<< "\n";
           }
@@ -878,13 +907,14 @@ List growthDay1(List x, NumericVector meteovec,
 List growthDay2(List x, NumericVector meteovec, 
                 double latitude, double elevation, double slope, double aspect,
                 double solarConstant, double delta, 
-                double runon=0.0, bool verbose = false) {
+                double runon=0.0, bool verbose = false, List subdailyForcing = List(), 
+                ScratchArena* arena = NULL) {
   
   //1. Soil-plant water balance
   List spwbOut = spwbDay2(x, meteovec, 
                           latitude, elevation, slope, aspect,
                           solarConstant, delta, 
-                          runon, verbose);
+                          runon, verbose, subdailyForcing, arena);
   
 
   //2. Retrieve state
@@ -906,7 +936,7 @@ List growthDay2(List x, NumericVector meteovec,
   
   double tday = meteoland::utils_averageDaylightTemperature(tmin, tmax);
   
-  String mortalityMode = control["mortalityMode"];
+  int mortalityMode = mortalityModeCode(Rcpp::as<String>(control["mortalityMode"]));
   double mortalityBaselineRate = control["mortalityBaselineRate"];
   double mortalityRelativeSugarThreshold= control["mortalityRelativeSugarThreshold"];
   double mortalityRWCThreshold= control["mortalityRWCThreshold"];
@@ -916,8 +946,9 @@ List growthDay2(List x, NumericVector meteovec,
   bool allowDefoliation = control["allowDefoliation"];
   bool sinkLimitation = control["sinkLimitation"];
   bool shrubDynamics = control["shrubDynamics"];
-  String allocationStrategy = control["allocationStrategy"];
+  int allocationStrategy = allocationStrategyCode(Rcpp::as<String>(control["allocationStrategy"]));
   String cavitationRefill = control["cavitationRefill"];
+  bool growthRefill = (cavitationRefill=="growth");
   bool plantWaterPools = control["plantWaterPools"];
   bool taper = control["taper"];
   bool nonStomatalPhotosynthesisLimitation = control["nonStomatalPhotosynthesisLimitation"];
@@ -1152,7 +1183,9 @@ List growthDay2(List x, NumericVector meteovec,
       double k_phloem = VCstem_kmax[j]*phloemConductanceFactor*(0.018/1000.0);
         
       //3.0 Xylogenesis
+      double diagRing = diagnosticsStart();
       grow_ring(ringList[j], psiSympStem[j] ,tday, 10.0);
+      diagnosticsStop(DIAGNOSTICS_GROW_RING, diagRing);
       double rleafcell = std::min(rleafcellmax, relative_expansion_rate(psiSympLeaf[j] ,tday, LeafPI0[j],0.5,0.05,5.0));
       NumericVector rfineroot(numLayers);
       for(int s=0;s<numLayers;s++) rfineroot[s] = relative_expansion_rate(RhizoPsi(j,s) ,tday, StemPI0[j],0.5,0.05,5.0);
@@ -1255,6 +1288,7 @@ List growthDay2(List x, NumericVector meteovec,
         double ff = 0.0;
         double ctl = 3600.0*Volume_leaves[j]*glucoseMolarMass;
         double cts = 3600.0*Volume_sapwood[j]*glucoseMolarMass;
+        double diagPhloem = diagnosticsStart();
         for(int t=0;t<3600;t++) {
           sugarSapwood[j] += sapwoodSugarMassDeltaStep/cts;
           starchSapwood[j] += sapwoodStarchMassDeltaStep/cts;
@@ -1285,6 +1319,7 @@ List growthDay2(List x, NumericVector meteovec,
             sugarSapwood[j] += (- starchSapwoodIncrease);
           }
         }
+        diagnosticsStop(DIAGNOSTICS_PHLOEM_TRANSPORT, diagPhloem);
         //Divert to root exudation if starch is over maximum capacity
         if(starchLeaf[j] > Starch_max_leaves[j]) {
           RootExudationInst(j,s) += ((starchLeaf[j] - Starch_max_leaves[j])*(Volume_leaves[j]*glucoseMolarMass)/TotalLivingBiomass[j]);
@@ -1439,7 +1474,7 @@ List growthDay2(List x, NumericVector meteovec,
         else NSPL[j] = 1.0;
       }
       //Decrease PLC due to new SA growth
-      if(cavitationRefill=="growth") StemPLC[j] = std::max(0.0, StemPLC[j] - (deltaSAgrowth[j]/SA[j]));
+      if(growthRefill) StemPLC[j] = std::max(0.0, StemPLC[j] - (deltaSAgrowth[j]/SA[j]));
       
       
       //LEAF/FINE ROOT BIOMASS balance (g_ind)
@@ -1453,7 +1488,7 @@ List growthDay2(List x, NumericVector meteovec,
       bool isShrub = !NumericVector::is_na(Cover[j]);
       if((!shrubDynamics) & isShrub) dynamicCohort = false;
       if(dynamicCohort) {
-        if(mortalityMode=="whole-cohort/deterministic") {
+        if(mortalityMode==MORTALITY_WHOLECOHORT_DETERMINISTIC) {
           if((sugarSapwood[j]<mortalitySugarThreshold) & allowStarvation) {
             Ndead_day = N[j];
             if(verbose) Rcout<<" [Cohort "<< j<<" died from starvation] ";
@@ -1467,9 +1502,9 @@ List growthDay2(List x, NumericVector meteovec,
           if(allowDessication) dessicationRate[j] = dailyMortalityProbability(basalMortalityRate, StemSympRWC[j], mortalityRWCThreshold, 0.0);
           mortalityRate[j] = max(NumericVector::create(basalMortalityRate, dessicationRate[j],  starvationRate[j]));
           
-          if(mortalityMode =="density/deterministic") {
+          if(mortalityMode==MORTALITY_DENSITY_DETERMINISTIC) {
             Ndead_day = N[j]*mortalityRate[j];
-          } else if(mortalityMode =="whole-cohort/stochastic") {
+          } else if(mortalityMode==MORTALITY_WHOLECOHORT_STOCHASTIC) {
             if(R::runif(0.0,1.0) < mortalityRate[j]) {
               Ndead_day = N[j];
               if(dessicationRate[j]>starvationRate[j]) {
@@ -1478,7 +1513,7 @@ List growthDay2(List x, NumericVector meteovec,
                 Rcout<<" [Cohort "<< j<<" died from starvation] ";
               }
             }
-          } else if(mortalityMode =="density/stochastic") {
+          } else if(mortalityMode==MORTALITY_DENSITY_STOCHASTIC) {
             // NumericVector nv = Rcpp::runif(round(N[j]), 0.0,1.0);
             // for(int k=0;k<nv.size();k++) if(nv[k]< P_day) Ndead_day += 1.0;
             Ndead_day = R::rbinom(round(N[j]), mortalityRate[j]);
@@ -1505,9 +1540,9 @@ List growthDay2(List x, NumericVector meteovec,
       //UPDATE TARGETS
       //Set leaf area target if bud formation is allowed
       if(budFormation[j]) {
-        if(allocationStrategy == "Plant_kmax") {
+        if(allocationStrategy==ALLOCATION_PLANT_KMAX) {
           leafAreaTarget[j] = LAlive*(Plant_kmax[j]/allocationTarget[j]);
-        } else if(allocationStrategy =="Al2As") {
+        } else if(allocationStrategy==ALLOCATION_AL2AS) {
           leafAreaTarget[j] = (SA[j]/10000.0)*allocationTarget[j];
         }
         LAI_live[j] =  leafAreaTarget[j]*N[j]/10000.0;
@@ -1931,6 +1966,27 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
   }
   CharacterVector dateStrings = meteo.attr("row.names");
   
+  //Precomputed daily and subdaily forcing (see meteoForcing)
+  bool forcing_input = isCompatibleMeteoForcing(meteo, latitude, elevation, slope, aspect, 
+                                                Rcpp::as<int>(control["ndailysteps"]), transpirationMode=="Sperry");
+  List subdailyForcing;
+  NumericVector PETForcing, SolarDeclination, SolarConstant;
+  if(forcing_input) {
+    List forcing = meteo.attr("forcing");
+    subdailyForcing = meteo.attr("subdaily");
+    DOY = forcing["DOY"];
+    Photoperiod = forcing["Photoperiod"];
+    JulianDay = forcing["JulianDay"];
+    PETForcing = forcing["PET"];
+    SolarDeclination = forcing["SolarDeclination"];
+    SolarConstant = forcing["SolarConstant"];
+    doy_input = true;
+    photoperiod_input = true;
+    julianday_input = true;
+    if(verbose) {
+      Rcout<<"Daily and subdaily forcing taken from 'meteoForcing' object\n";
+    }
+  }
   if(!doy_input) DOY = date2doy(dateStrings);
   if(!photoperiod_input) Photoperiod = date2photoperiod(dateStrings, latrad);
   
@@ -1964,61 +2020,129 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
   //Detailed subday results
   List subdailyRes(numDays);
   
+  //In-run temporal aggregation (daily outputs are then kept in two-row buffers)
+  TemporalAggregator aggregator(control, dateStrings, cohorts);
+  int numRows = aggregator.outputRows(numDays);
+  DataFrame outputFrame = aggregator.outputFrame(meteo);
+  
+  //In-run drought stress indices
+  DroughtStressAccumulator stressIndices(control, dateStrings, cohorts);
+  
   //EnergyBalance output variables
-  DataFrame DEB = defineEnergyBalanceDailyOutput(meteo);
-  DataFrame DT = defineTemperatureDailyOutput(meteo);
+  DataFrame DEB = defineEnergyBalanceDailyOutput(outputFrame);
+  DataFrame DT = defineTemperatureDailyOutput(outputFrame);
   NumericMatrix DLT;
-  if(transpirationMode=="Sperry") DLT =  defineTemperatureLayersDailyOutput(meteo, canopy);
+  if(transpirationMode=="Sperry") DLT =  defineTemperatureLayersDailyOutput(outputFrame, canopy);
   
   //Plant carbon output variables
-  NumericMatrix LabileCarbonBalance(numDays, numCohorts);
-  NumericMatrix MaintenanceRespiration(numDays, numCohorts);
-  NumericMatrix GrowthCosts(numDays, numCohorts);
-  NumericMatrix PlantSugarLeaf(numDays, numCohorts);
-  NumericMatrix PlantStarchLeaf(numDays, numCohorts);
-  NumericMatrix PlantSugarSapwood(numDays, numCohorts);
-  NumericMatrix PlantStarchSapwood(numDays, numCohorts);
-  NumericMatrix PlantSugarTransport(numDays, numCohorts);
-  NumericMatrix SapwoodBiomass(numDays, numCohorts);
-  NumericMatrix LeafBiomass(numDays, numCohorts);
-  NumericMatrix SapwoodArea(numDays, numCohorts);
-  NumericMatrix LeafArea(numDays, numCohorts);
-  NumericMatrix FineRootArea(numDays, numCohorts);
-  NumericMatrix FineRootBiomass(numDays, numCohorts);
-  NumericMatrix HuberValue(numDays, numCohorts);
-  NumericMatrix RootAreaLeafArea(numDays, numCohorts);
-  NumericMatrix DBH(numDays, numCohorts);
-  NumericMatrix Height(numDays, numCohorts);
-  NumericMatrix LabileBiomass(numDays, numCohorts);
-  NumericMatrix TotalBiomass(numDays, numCohorts);
-  NumericMatrix SAgrowth(numDays, numCohorts), LAgrowth(numDays, numCohorts), FRAgrowth(numDays, numCohorts);
-  NumericMatrix starvationRate(numDays, numCohorts), dessicationRate(numDays, numCohorts), mortalityRate(numDays, numCohorts);
-  NumericMatrix GrossPhotosynthesis(numDays, numCohorts);
-  NumericMatrix PlantLAIexpanded(numDays, numCohorts), PlantLAIdead(numDays, numCohorts), PlantLAIlive(numDays, numCohorts);
-  NumericMatrix StemPI0(numDays, numCohorts), LeafPI0(numDays, numCohorts);
-  NumericMatrix RootExudation(numDays, numCohorts);
-  NumericMatrix StructuralBiomassBalance(numDays, numCohorts);
-  NumericMatrix LabileBiomassBalance(numDays, numCohorts);
-  NumericMatrix PlantBiomassBalance(numDays, numCohorts);
-  NumericMatrix MortalityBiomassLoss(numDays, numCohorts);
-  NumericMatrix CohortBiomassBalance(numDays, numCohorts);
-  NumericMatrix StandBiomassBalance(numDays, 5);
+  NumericMatrix LabileCarbonBalance(numRows, numCohorts);
+  NumericMatrix MaintenanceRespiration(numRows, numCohorts);
+  NumericMatrix GrowthCosts(numRows, numCohorts);
+  NumericMatrix PlantSugarLeaf(numRows, numCohorts);
+  NumericMatrix PlantStarchLeaf(numRows, numCohorts);
+  NumericMatrix PlantSugarSapwood(numRows, numCohorts);
+  NumericMatrix PlantStarchSapwood(numRows, numCohorts);
+  NumericMatrix PlantSugarTransport(numRows, numCohorts);
+  NumericMatrix SapwoodBiomass(numRows, numCohorts);
+  NumericMatrix LeafBiomass(numRows, numCohorts);
+  NumericMatrix SapwoodArea(numRows, numCohorts);
+  NumericMatrix LeafArea(numRows, numCohorts);
+  NumericMatrix FineRootArea(numRows, numCohorts);
+  NumericMatrix FineRootBiomass(numRows, numCohorts);
+  NumericMatrix HuberValue(numRows, numCohorts);
+  NumericMatrix RootAreaLeafArea(numRows, numCohorts);
+  NumericMatrix DBH(numRows, numCohorts);
+  NumericMatrix Height(numRows, numCohorts);
+  NumericMatrix LabileBiomass(numRows, numCohorts);
+  NumericMatrix TotalBiomass(numRows, numCohorts);
+  NumericMatrix SAgrowth(numRows, numCohorts), LAgrowth(numRows, numCohorts), FRAgrowth(numRows, numCohorts);
+  NumericMatrix starvationRate(numRows, numCohorts), dessicationRate(numRows, numCohorts), mortalityRate(numRows, numCohorts);
+  NumericMatrix GrossPhotosynthesis(numRows, numCohorts);
+  NumericMatrix PlantLAIexpanded(numRows, numCohorts), PlantLAIdead(numRows, numCohorts), PlantLAIlive(numRows, numCohorts);
+  NumericMatrix StemPI0(numRows, numCohorts), LeafPI0(numRows, numCohorts);
+  NumericMatrix RootExudation(numRows, numCohorts);
+  NumericMatrix StructuralBiomassBalance(numRows, numCohorts);
+  NumericMatrix LabileBiomassBalance(numRows, numCohorts);
+  NumericMatrix PlantBiomassBalance(numRows, numCohorts);
+  NumericMatrix MortalityBiomassLoss(numRows, numCohorts);
+  NumericMatrix CohortBiomassBalance(numRows, numCohorts);
+  NumericMatrix StandBiomassBalance(numRows, 5);
   
   //Water balance output variables
-  DataFrame DWB = defineWaterBalanceDailyOutput(meteo, PET, transpirationMode);
-  DataFrame SWB = defineSoilWaterBalanceDailyOutput(meteo, soil, transpirationMode);
+  DataFrame DWB = defineWaterBalanceDailyOutput(outputFrame, (aggregator.active ? NumericVector(numRows, NA_REAL) : PET), transpirationMode);
+  DataFrame SWB = defineSoilWaterBalanceDailyOutput(outputFrame, soil, transpirationMode);
   
   
-  NumericVector LAI(numDays), LAIlive(numDays), LAIexpanded(numDays), LAIdead(numDays);
-  NumericVector Cm(numDays);
-  NumericVector LgroundPAR(numDays);
-  NumericVector LgroundSWR(numDays);
+  NumericVector LAI(numRows), LAIlive(numRows), LAIexpanded(numRows), LAIdead(numRows);
+  NumericVector Cm(numRows);
+  NumericVector LgroundPAR(numRows);
+  NumericVector LgroundSWR(numRows);
 
   //Plant water output variables
-  List sunlitDO = defineSunlitShadeLeavesDailyOutput(meteo, above);
-  List shadeDO = defineSunlitShadeLeavesDailyOutput(meteo, above);
-  List plantDWOL = definePlantWaterDailyOutput(meteo, above, soil, control);
+  List sunlitDO = defineSunlitShadeLeavesDailyOutput(outputFrame, above);
+  List shadeDO = defineSunlitShadeLeavesDailyOutput(outputFrame, above);
+  List plantDWOL = definePlantWaterDailyOutput(outputFrame, above, soil, control);
   NumericVector EplantCohTot(numCohorts, 0.0);
+  
+  //Plant growth output variables (row contents are filled in place)
+  List labileCarbonBalance = List::create(
+    Named("GrossPhotosynthesis") = GrossPhotosynthesis,
+    Named("MaintenanceRespiration") = MaintenanceRespiration,
+    Named("GrowthCosts") = GrowthCosts,
+    Named("RootExudation") = RootExudation,
+    Named("LabileCarbonBalance") = LabileCarbonBalance,
+    Named("SugarLeaf") = PlantSugarLeaf,
+    Named("StarchLeaf") = PlantStarchLeaf,
+    Named("SugarSapwood") = PlantSugarSapwood,
+    Named("StarchSapwood") = PlantStarchSapwood,
+    Named("SugarTransport") = PlantSugarTransport,
+    Named("LeafPI0") = LeafPI0,
+    Named("StemPI0") = StemPI0
+  );
+  List plantBiomassBalance = List::create(_["StructuralBiomassBalance"] = StructuralBiomassBalance,
+                                     _["LabileBiomassBalance"] = LabileBiomassBalance,
+                                     _["PlantBiomassBalance"] = PlantBiomassBalance,
+                                     _["MortalityBiomassLoss"] = MortalityBiomassLoss,
+                                     _["CohortBiomassBalance"] = CohortBiomassBalance);
+  
+  List growthMortality, plantStructure;
+  
+  plantStructure = List::create(Named("LeafBiomass")=LeafBiomass,
+                                Named("SapwoodBiomass") = SapwoodBiomass,
+                                Named("FineRootBiomass") = FineRootBiomass,
+                                Named("LeafArea") = LeafArea,
+                                Named("SapwoodArea")=SapwoodArea,
+                                Named("FineRootArea") = FineRootArea,
+                                Named("HuberValue") = HuberValue,
+                                Named("RootAreaLeafArea") = RootAreaLeafArea,
+                                Named("DBH") = DBH,
+                                Named("Height") = Height);
+  growthMortality = List::create(Named("LAgrowth") = LAgrowth,
+                                 Named("SAgrowth") = SAgrowth,
+                                 Named("FRAgrowth") = FRAgrowth,
+                                 Named("StarvationRate") = starvationRate,
+                                 Named("DessicationRate") = dessicationRate,
+                                 Named("MortalityRate") = mortalityRate);
+  
+  List standDO = List::create(_["LAI"]=LAI, _["LAIlive"]=LAIlive, _["LAIexpanded"]=LAIexpanded,_["LAIdead"]=LAIdead,
+                              _["Cm"]=Cm, 
+                              _["LgroundPAR"] = LgroundPAR, _["LgroundSWR"] = LgroundSWR);
+  if(aggregator.active) {
+    List buffer = List::create(_["WaterBalance"] = DWB, _["BiomassBalance"] = StandBiomassBalance,
+                               _["Soil"] = SWB, _["Stand"] = standDO, _["Plants"] = plantDWOL);
+    if(transpirationMode=="Sperry") {
+      buffer.push_back(DEB, "EnergyBalance");
+      buffer.push_back(DT, "Temperature");
+      if(multiLayerBalance) buffer.push_back(DLT, "TemperatureLayers");
+      buffer.push_back(sunlitDO, "SunlitLeaves");
+      buffer.push_back(shadeDO, "ShadeLeaves");
+    }
+    buffer.push_back(labileCarbonBalance, "LabileCarbonBalance");
+    buffer.push_back(plantBiomassBalance, "PlantBiomassBalance");
+    buffer.push_back(plantStructure, "PlantStructure");
+    buffer.push_back(growthMortality, "GrowthMortality");
+    aggregator.setBuffer(buffer);
+  }
 
   
   //Count years (times structural variables will be updated)
@@ -2039,11 +2163,23 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
     Rcout<<"Initial snowpack content (mm): "<< initialSnowContent<<"\n";
   }
   
+  resetDiagnostics(diagnosticsRequested(control));
+  SimulationRun simulationRun;
+  ScratchArena arena;
+  int progressDays = progressInterval(control);
+  int simulatedDays = numDays;
   bool error_occurence = false;
   if(verbose) Rcout << "Performing daily simulations\n";
   List s;
   int iyear = 0;
   for(int i=0;i<numDays;i++) {
+    if((progressDays > 0) && (i > 0) && ((i % progressDays)==0)) {
+      if(simulationCancelled(control, i, numDays)) {
+        simulatedDays = i;
+        break;
+      }
+    }
+    int iRow = (aggregator.active ? 0 : i);
     if(verbose) {
       if(DOY[i]==1 || i==0) {
         std::string c = as<std::string>(dateStrings[i]);
@@ -2091,8 +2227,14 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
         std::string c = as<std::string>(dateStrings[i]);
         J = meteoland::radiation_julianDay(std::atoi(c.substr(0, 4).c_str()),std::atoi(c.substr(5,2).c_str()),std::atoi(c.substr(8,2).c_str())); 
       }
-      double delta = meteoland::radiation_solarDeclination(J);
-      double solarConstant = meteoland::radiation_solarConstant(J);
+      double delta, solarConstant;
+      if(forcing_input) {
+        delta = SolarDeclination[i];
+        solarConstant = SolarConstant[i];
+      } else {
+        delta = meteoland::radiation_solarDeclination(J);
+        solarConstant = meteoland::radiation_solarConstant(J);
+      }
       double latrad = latitude * (M_PI/180.0);
       if(NumericVector::is_na(aspect)) aspect = 0.0;
       if(NumericVector::is_na(slope)) slope = 0.0;
@@ -2113,7 +2255,8 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
       double rad = Radiation[i];
       double Catm = CO2[i];
       if(NumericVector::is_na(Catm)) Catm = control["Catm"];
-      PET[i] = meteoland::penman(latrad, elevation, slorad, asprad, J, tmin, tmax, rhmin, rhmax, rad, wind);
+      if(forcing_input) PET[i] = PETForcing[i];
+      else PET[i] = meteoland::penman(latrad, elevation, slorad, asprad, J, tmin, tmax, rhmin, rhmax, rad, wind);
       NumericVector meteovec = NumericVector::create(
         Named("tmin") = tmin, 
         Named("tmax") = tmax,
@@ -2128,31 +2271,33 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
         Named("Catm") = Catm,
         Named("pet") = PET[i],
         Named("er") = erFactor(DOY[i], PET[i], Precipitation[i]));
+      List sdForcing;
+      if(forcing_input) sdForcing = meteoForcingDay(subdailyForcing, i);
       try{
         s = growthDay2(x, meteovec, 
                        latitude, elevation, slope, aspect,
                        solarConstant, delta, 
-                       0.0, verbose);
+                       0.0, verbose, sdForcing, &arena);
       } catch(std::exception& ex) {
         Rcerr<< "c++ error: "<< ex.what() <<"\n";
         error_occurence = true;
       }
-      fillEnergyBalanceTemperatureDailyOutput(DEB,DT,DLT,s,i, multiLayerBalance);
+      fillEnergyBalanceTemperatureDailyOutput(DEB,DT,DLT,s,iRow, multiLayerBalance);
     }    
     
-    fillPlantWaterDailyOutput(plantDWOL, sunlitDO, shadeDO, s, i, transpirationMode);
-    fillWaterBalanceDailyOutput(DWB, s,i, transpirationMode);
+    fillPlantWaterDailyOutput(plantDWOL, sunlitDO, shadeDO, s, iRow, transpirationMode);
+    fillWaterBalanceDailyOutput(DWB, s,iRow, transpirationMode);
     fillSoilWaterBalanceDailyOutput(SWB, soil, s,
-                                    i, numDays, transpirationMode, soilFunctions);
+                                    iRow, numRows, transpirationMode, soilFunctions);
     
     List stand = s["Stand"];
-    LgroundPAR[i] = stand["LgroundPAR"];
-    LgroundSWR[i] = stand["LgroundSWR"];
-    LAI[i] = stand["LAI"];
-    LAIlive[i] = stand["LAIlive"];
-    LAIexpanded[i] = stand["LAIexpanded"];
-    LAIdead[i] = stand["LAIdead"];
-    Cm[i] = stand["Cm"];
+    LgroundPAR[iRow] = stand["LgroundPAR"];
+    LgroundSWR[iRow] = stand["LgroundSWR"];
+    LAI[iRow] = stand["LAI"];
+    LAIlive[iRow] = stand["LAIlive"];
+    LAIexpanded[iRow] = stand["LAIexpanded"];
+    LAIdead[iRow] = stand["LAIdead"];
+    Cm[iRow] = stand["Cm"];
     
     List sb = s["Soil"];
     List db = s["WaterBalance"];
@@ -2164,45 +2309,45 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
     
     
     //4. Assemble output
-    LabileCarbonBalance(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["LabileCarbonBalance"]);
-    MaintenanceRespiration(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["MaintenanceRespiration"]);
-    GrowthCosts(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["GrowthCosts"]);
-    GrossPhotosynthesis(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["GrossPhotosynthesis"]);
-    PlantSugarLeaf(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarLeaf"]);
-    PlantStarchLeaf(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["StarchLeaf"]);
-    PlantSugarSapwood(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarSapwood"]);
-    PlantStarchSapwood(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["StarchSapwood"]);
-    PlantSugarTransport(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarTransport"]);
-    StemPI0(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["StemPI0"]); 
-    LeafPI0(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["LeafPI0"]); 
-    RootExudation(i,_) = Rcpp::as<Rcpp::NumericVector>(cb["RootExudation"]);
+    LabileCarbonBalance(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["LabileCarbonBalance"]);
+    MaintenanceRespiration(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["MaintenanceRespiration"]);
+    GrowthCosts(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["GrowthCosts"]);
+    GrossPhotosynthesis(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["GrossPhotosynthesis"]);
+    PlantSugarLeaf(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarLeaf"]);
+    PlantStarchLeaf(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["StarchLeaf"]);
+    PlantSugarSapwood(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarSapwood"]);
+    PlantStarchSapwood(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["StarchSapwood"]);
+    PlantSugarTransport(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["SugarTransport"]);
+    StemPI0(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["StemPI0"]); 
+    LeafPI0(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["LeafPI0"]); 
+    RootExudation(iRow,_) = Rcpp::as<Rcpp::NumericVector>(cb["RootExudation"]);
     
-    SapwoodBiomass(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["SapwoodBiomass"]);
-    LeafBiomass(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["LeafBiomass"]);
-    FineRootBiomass(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["FineRootBiomass"]);
-    SapwoodArea(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["SapwoodArea"]);
-    LeafArea(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["LeafArea"]);
-    FineRootArea(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["FineRootArea"]);
-    HuberValue(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["HuberValue"]);
-    RootAreaLeafArea(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["RootAreaLeafArea"]);
-    DBH(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["DBH"]);
-    Height(i,_) = Rcpp::as<Rcpp::NumericVector>(ps["Height"]);
+    SapwoodBiomass(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["SapwoodBiomass"]);
+    LeafBiomass(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["LeafBiomass"]);
+    FineRootBiomass(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["FineRootBiomass"]);
+    SapwoodArea(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["SapwoodArea"]);
+    LeafArea(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["LeafArea"]);
+    FineRootArea(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["FineRootArea"]);
+    HuberValue(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["HuberValue"]);
+    RootAreaLeafArea(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["RootAreaLeafArea"]);
+    DBH(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["DBH"]);
+    Height(iRow,_) = Rcpp::as<Rcpp::NumericVector>(ps["Height"]);
     
-    StructuralBiomassBalance(i,_) = Rcpp::as<Rcpp::NumericVector>(bb["StructuralBiomassBalance"]);
-    LabileBiomassBalance(i,_) = Rcpp::as<Rcpp::NumericVector>(bb["LabileBiomassBalance"]);
-    PlantBiomassBalance(i,_) = Rcpp::as<Rcpp::NumericVector>(bb["PlantBiomassBalance"]);
-    MortalityBiomassLoss(i,_) = Rcpp::as<Rcpp::NumericVector>(bb["MortalityBiomassLoss"]);
-    CohortBiomassBalance(i,_) = Rcpp::as<Rcpp::NumericVector>(bb["CohortBiomassBalance"]);
-    StandBiomassBalance(i,_) = standLevelBiomassBalance(bb);
-    cohortBiomassBalanceSum += sum(CohortBiomassBalance(i,_));
-
-    LAgrowth(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["LAgrowth"]);
-    SAgrowth(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["SAgrowth"]);
-    FRAgrowth(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["FRAgrowth"]);
+    StructuralBiomassBalance(iRow,_) = Rcpp::as<Rcpp::NumericVector>(bb["StructuralBiomassBalance"]);
+    LabileBiomassBalance(iRow,_) = Rcpp::as<Rcpp::NumericVector>(bb["LabileBiomassBalance"]);
+    PlantBiomassBalance(iRow,_) = Rcpp::as<Rcpp::NumericVector>(bb["PlantBiomassBalance"]);
+    MortalityBiomassLoss(iRow,_) = Rcpp::as<Rcpp::NumericVector>(bb["MortalityBiomassLoss"]);
+    CohortBiomassBalance(iRow,_) = Rcpp::as<Rcpp::NumericVector>(bb["CohortBiomassBalance"]);
+    StandBiomassBalance(iRow,_) = standLevelBiomassBalance(bb);
+    cohortBiomassBalanceSum += sum(CohortBiomassBalance(iRow,_));
+
+    LAgrowth(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["LAgrowth"]);
+    SAgrowth(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["SAgrowth"]);
+    FRAgrowth(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["FRAgrowth"]);
     
-    starvationRate(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["StarvationRate"]);
-    dessicationRate(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["DessicationRate"]);
-    mortalityRate(i,_) = Rcpp::as<Rcpp::NumericVector>(gm["MortalityRate"]);
+    starvationRate(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["StarvationRate"]);
+    dessicationRate(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["DessicationRate"]);
+    mortalityRate(iRow,_) = Rcpp::as<Rcpp::NumericVector>(gm["MortalityRate"]);
     
 
     //5 Update structural variables
@@ -2212,6 +2357,13 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
       for(int j=0;j<numCohorts; j++) ringList[j] = initialize_ring();
     }
 
+    if(stressIndices.active) stressIndices.addDay(i, s["Plants"], transpirationMode);
+    if(aggregator.active) {
+      NumericVector PETrow = as<Rcpp::NumericVector>(DWB["PET"]);
+      PETrow[iRow] = PET[i];
+      aggregator.addDay(i);
+    }
+    
     if(subdailyResults) {
       subdailyRes[i] = clone(s);
     }
@@ -2221,7 +2373,7 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
   // Check biomass balance
   DataFrame ccFin_m2 = carbonCompartments(x, "g_m2");
   double finalCohortBiomass = sum(Rcpp::as<Rcpp::NumericVector>(ccFin_m2["TotalBiomass"]));
-  if(verbose) {
+  if(verbose && (!aggregator.active)) {
     Rcout<<"Final plant biomass (g/m2): "<<finalCohortBiomass<<"\n";
     Rcout<<"Change in plant biomass (g/m2): " << finalCohortBiomass - initialCohortBiomass <<"\n";
     Rcout<<"Plant biomass balance result (g/m2): " <<  cohortBiomassBalanceSum<<"\n";
@@ -2233,49 +2385,53 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
     printWaterBalanceResult(DWB, plantDWOL, soil, soilFunctions,
                             initialContent, initialSnowContent,
                             transpirationMode);
-    
+  }
+  if(verbose) {
     if(error_occurence) {
       Rcout<< " ERROR: Calculations stopped because of numerical error: Revise parameters\n";
     }
+    if(simulatedDays < numDays) {
+      Rcout<< " Simulation cancelled after "<< simulatedDays << " days\n";
+    }
   }
   
   
   //Add matrix dimnames
-  LabileCarbonBalance.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  GrossPhotosynthesis.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  MaintenanceRespiration.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  GrowthCosts.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  PlantSugarLeaf.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  PlantStarchLeaf.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  PlantSugarSapwood.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  PlantStarchSapwood.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  PlantSugarTransport.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  SapwoodBiomass.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  LeafBiomass.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  FineRootArea.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  SapwoodArea.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  LeafArea.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  HuberValue.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  RootAreaLeafArea.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  FineRootBiomass.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  DBH.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  Height.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  LAgrowth.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  SAgrowth.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  FRAgrowth.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  dessicationRate.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  mortalityRate.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names")) ;
-  starvationRate.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  StemPI0.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names"));
-  LeafPI0.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names"));
-  RootExudation.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  StructuralBiomassBalance.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  LabileBiomassBalance.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  PlantBiomassBalance.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  MortalityBiomassLoss.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-  CohortBiomassBalance.attr("dimnames") = List::create(meteo.attr("row.names"), cohorts.attr("row.names"));
-
-  StandBiomassBalance.attr("dimnames") = List::create(meteo.attr("row.names"), 
+  LabileCarbonBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  GrossPhotosynthesis.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  MaintenanceRespiration.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  GrowthCosts.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  PlantSugarLeaf.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  PlantStarchLeaf.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  PlantSugarSapwood.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  PlantStarchSapwood.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  PlantSugarTransport.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  SapwoodBiomass.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  LeafBiomass.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  FineRootArea.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  SapwoodArea.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  LeafArea.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  HuberValue.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  RootAreaLeafArea.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  FineRootBiomass.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  DBH.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  Height.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  LAgrowth.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  SAgrowth.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  FRAgrowth.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  dessicationRate.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  mortalityRate.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names")) ;
+  starvationRate.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  StemPI0.attr("dimnames") = List::create(outputFrame.attr("row.names"), above.attr("row.names"));
+  LeafPI0.attr("dimnames") = List::create(outputFrame.attr("row.names"), above.attr("row.names"));
+  RootExudation.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  StructuralBiomassBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  LabileBiomassBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  PlantBiomassBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  MortalityBiomassLoss.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+  CohortBiomassBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), cohorts.attr("row.names"));
+
+  StandBiomassBalance.attr("dimnames") = List::create(outputFrame.attr("row.names"), 
                            CharacterVector::create("StructuralBalance", "LabileBalance", "PlantBalance", "MortalityLoss", "CohortBalance"));
   
   subdailyRes.attr("names") = meteo.attr("row.names") ;
@@ -2283,52 +2439,11 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
   NumericVector topo = NumericVector::create(elevation, slope, aspect);
   topo.attr("names") = CharacterVector::create("elevation", "slope", "aspect");
   
-  Rcpp::DataFrame Stand = DataFrame::create(_["LAI"]=LAI, _["LAIlive"]=LAIlive, _["LAIexpanded"]=LAIexpanded,_["LAIdead"]=LAIdead,
-                                            _["Cm"]=Cm, 
-                                            _["LgroundPAR"] = LgroundPAR, _["LgroundSWR"] = LgroundSWR);
-  Stand.attr("row.names") = meteo.attr("row.names");
+  Rcpp::DataFrame Stand = DataFrame(standDO);
+  Stand.attr("row.names") = outputFrame.attr("row.names");
 
   
-  // Assemble output
-  List labileCarbonBalance = List::create(
-    Named("GrossPhotosynthesis") = GrossPhotosynthesis,
-    Named("MaintenanceRespiration") = MaintenanceRespiration,
-    Named("GrowthCosts") = GrowthCosts,
-    Named("RootExudation") = RootExudation,
-    Named("LabileCarbonBalance") = LabileCarbonBalance,
-    Named("SugarLeaf") = PlantSugarLeaf,
-    Named("StarchLeaf") = PlantStarchLeaf,
-    Named("SugarSapwood") = PlantSugarSapwood,
-    Named("StarchSapwood") = PlantStarchSapwood,
-    Named("SugarTransport") = PlantSugarTransport,
-    Named("LeafPI0") = LeafPI0,
-    Named("StemPI0") = StemPI0
-  );
-  List plantBiomassBalance = List::create(_["StructuralBiomassBalance"] = StructuralBiomassBalance,
-                                     _["LabileBiomassBalance"] = LabileBiomassBalance,
-                                     _["PlantBiomassBalance"] = PlantBiomassBalance,
-                                     _["MortalityBiomassLoss"] = MortalityBiomassLoss,
-                                     _["CohortBiomassBalance"] = CohortBiomassBalance);
-  
-  List growthMortality, plantStructure;
-  
   List l;
-  plantStructure = List::create(Named("LeafBiomass")=LeafBiomass,
-                                Named("SapwoodBiomass") = SapwoodBiomass,
-                                Named("FineRootBiomass") = FineRootBiomass,
-                                Named("LeafArea") = LeafArea,
-                                Named("SapwoodArea")=SapwoodArea,
-                                Named("FineRootArea") = FineRootArea,
-                                Named("HuberValue") = HuberValue,
-                                Named("RootAreaLeafArea") = RootAreaLeafArea,
-                                Named("DBH") = DBH,
-                                Named("Height") = Height);
-  growthMortality = List::create(Named("LAgrowth") = LAgrowth,
-                                 Named("SAgrowth") = SAgrowth,
-                                 Named("FRAgrowth") = FRAgrowth,
-                                 Named("StarvationRate") = starvationRate,
-                                 Named("DessicationRate") = dessicationRate,
-                                 Named("MortalityRate") = mortalityRate);
   if(transpirationMode=="Granier") {
     l = List::create(Named("latitude") = latitude,
                      Named("topography") = topo,
@@ -2365,6 +2480,25 @@ List growth(List x, DataFrame meteo, double latitude, double elevation = NA_REAL
                    Named("subdaily") =  subdailyRes);
     if(multiLayerBalance) l["TemperatureLayers"] = DLT;
   }
+  if(aggregator.active) {
+    List agg = aggregator.result();
+    CharacterVector aggNames = agg.attr("names");
+    for(int j=0;j<agg.size();j++) {
+      std::string name = as<std::string>(aggNames[j]);
+      l[name] = agg[j];
+    }
+    l.attr("aggregated") = true;
+  }
+  if(stressIndices.active) l.push_back(stressIndices.result(), "DroughtStress");
+  if(diagnosticsEnabled) {
+    l.push_back(diagnosticsList(), "Diagnostics");
+    resetDiagnostics(false);
+  }
   l.attr("class") = CharacterVector::create("growth","list");
+  if(simulatedDays < numDays) {
+    l = truncateDailyOutput(l, meteo.attr("row.names"), simulatedDays);
+    l.attr("simulatedDays") = simulatedDays;
+    warning("Simulation cancelled: results are partial (only the first " + std::to_string(simulatedDays) + " days were simulated).");
+  }
   return(l);
 }
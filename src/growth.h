@@ -3,6 +3,7 @@
 #ifndef GROWTH_H
 #define GROWTH_H
 #endif
+#include "scratcharena.h"
 using namespace Rcpp;
 
 List growthDay(List x, CharacterVector date, double tmin, double tmax, 
@@ -15,4 +16,5 @@ List growthDay1(List x, NumericVector meteovec,
 List growthDay2(List x, NumericVector meteovec, 
                 double latitude, double elevation, double slope, double aspect,
                 double solarConstant, double delta, 
-                double runon=0.0, bool verbose = false);
\ No newline at end of file
+                double runon=0.0, bool verbose = false, List subdailyForcing = List(), 
+                ScratchArena* arena = NULL);
\ No newline at end of file
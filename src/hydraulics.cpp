@@ -3,6 +3,7 @@
 #include "biophysicsutils.h"
 #include "tissuemoisture.h"
 #include "incgamma.h"
+#include "diagnostics.h"
 #include <math.h>
 
 
@@ -12,6 +13,12 @@ using namespace std;
 double const maxPsi = -0.000001;
 double const cmhead2MPa = 0.00009804139; //Constant to transform cm head to MPa
 
+//Outcomes of Newton-Raphson solvers and number of retries for calls that do not converge
+int const NEWTON_CONVERGED = 0;
+int const NEWTON_MAXITER = 1;
+int const NEWTON_DIVERGED = 2;
+int const NEWTON_RETRIES = 1;
+
 /**
  * Whole-plant conductance function (simple water balance model)
  */
@@ -145,12 +152,49 @@ double EXylem(double psiPlant, double psiUpstream,
   return(Egamma(psiPlant, kxylemmax, c, d, psiCav)-Egamma(psiUpstream, kxylemmax, c,d, psiCav));
 }
 
+/*
+ * Bisection fallback for E2psiXylem, used when the inverse incomplete gamma function fails.
+ * The solution is bracketed between the upstream potential and -40 MPa (or zero for negative flows).
+ */
+double E2psiXylemBisection(double E, double psiUpstream, 
+                           double kxylemmax, double c, double d, double psiCav = 0.0) {
+  double a = (E > 0.0) ? -40.0 : psiUpstream;
+  double b = (E > 0.0) ? psiUpstream : 0.0;
+  double fa = EXylem(a, psiUpstream, kxylemmax, c, d, true, psiCav) - E;
+  double fb = EXylem(b, psiUpstream, kxylemmax, c, d, true, psiCav) - E;
+  if(NumericVector::is_na(fa) || NumericVector::is_na(fb) || (fa*fb > 0.0)) return(NA_REAL);
+  for(int i=0;i<100;i++) {
+    double m = 0.5*(a + b);
+    double fm = EXylem(m, psiUpstream, kxylemmax, c, d, true, psiCav) - E;
+    if(fa*fm <= 0.0) {
+      b = m;
+    } else {
+      a = m;
+      fa = fm;
+    }
+    if((b - a) < 1e-8) break;
+  }
+  return(0.5*(a + b));
+}
+
 // [[Rcpp::export("hydraulics_E2psiXylem")]]
 double E2psiXylem(double E, double psiUpstream, 
                   double kxylemmax, double c, double d, double psiCav = 0.0) {
   if(E==0) return(psiUpstream);
   double Eg = E + Egamma(psiUpstream, kxylemmax, c,d, psiCav);
-  return(Egammainv(Eg, kxylemmax, c, d, psiCav));
+  double psi = Egammainv(Eg, kxylemmax, c, d, psiCav);
+  if(NumericVector::is_na(psi)) {
+    // Flows beyond the capacity of the xylem (between the upstream potential and -40 MPa, 
+    // or zero for negative flows) have no solution: this is not a solver failure
+    double Elim = EXylem((E > 0.0) ? -40.0 : 0.0, psiUpstream, kxylemmax, c, d, true, psiCav);
+    if(NumericVector::is_na(Elim) || ((E > 0.0) && (E > Elim)) || ((E < 0.0) && (E < Elim))) return(NA_REAL);
+    //The root is bracketed, retry with bisection
+    psi = E2psiXylemBisection(E, psiUpstream, kxylemmax, c, d, psiCav);
+    diagnosticsCount(DIAGNOSTICS_SOLVER_RETRIES);
+    if(!NumericVector::is_na(psi)) diagnosticsCount(DIAGNOSTICS_SOLVER_RECOVERED);
+    else diagnosticsCount(DIAGNOSTICS_XYLEM_NONCONVERGED);
+  }
+  return(psi);
 }
 
 // [[Rcpp::export("hydraulics_E2psiXylemUp")]]
@@ -401,55 +445,33 @@ void lubksb(NumericMatrix a, int n, IntegerVector indx, NumericVector b) {
 }
 
 
-// [[Rcpp::export("hydraulics_E2psiBelowground")]]
-List E2psiBelowground(double E, NumericVector psiSoil, 
-                  NumericVector krhizomax, NumericVector nsoil, NumericVector alphasoil,
-                  NumericVector krootmax, double rootc, double rootd, 
-                  NumericVector psiIni = NumericVector::create(0),
-                  int ntrial = 10, double psiTol = 0.0001, double ETol = 0.0001) {
+/*
+ * Newton-Raphson iterations for the below-ground network, starting from 'x'. 
+ * Steps are multiplied by 'damping' (<= 1). Returns NEWTON_CONVERGED, NEWTON_MAXITER if the 
+ * system did not converge in 'ntrial' iterations or NEWTON_DIVERGED if water potentials went 
+ * below -40 MPa (i.e. flow beyond the capacity of the network).
+ */
+int newtonBelowground(double E, NumericVector psiSoil, 
+                       NumericVector krhizomax, NumericVector nsoil, NumericVector alphasoil,
+                       NumericVector krootmax, double rootc, double rootd, 
+                       NumericVector x, NumericVector Eroot, NumericVector Erhizo,
+                       int ntrial, double psiTol, double ETol, double damping, int& niter) {
   int nlayers = psiSoil.length();
-  //Initialize
-  NumericVector x(nlayers+1);
-  if(psiIni.size()==(nlayers+1)){
-    for(int l=0;l<(nlayers+1);l++) {
-      x[l] = psiIni[l];
-    }
-  } else{
-    double minPsi = -0.00001;
-    for(int l=0;l<nlayers;l++) {
-      x[l] =psiSoil[l];
-      minPsi = std::min(minPsi, psiSoil[l]);
-      // Rcout<<"("<<x[l]<<") ";
-    }
-    x[nlayers] = minPsi;
-    // Rcout<<"("<<x[nlayers]<<")\n";
-    
-  }
-  
-  //Flow across root xylem and rhizosphere elements
-  NumericVector Eroot(nlayers), Erhizo(nlayers);
-  
-  //Newton-Raphson algorithm
   NumericVector p(nlayers+1), fvec(nlayers+1);
   IntegerVector indx(nlayers+1);
   NumericMatrix fjac(nlayers+1,nlayers+1);
   double Esum = 0.0;
   for(int k=0;k<ntrial;k++) {
-    // Rcout<<"trial "<<k<<"\n";
+    niter++;
     //Calculate steady-state flow functions
     Esum = 0.0;
-    bool stop = false;
     for(int l=0;l<nlayers;l++) {
       Eroot[l] = EXylem(x[nlayers], x[l], krootmax[l], rootc, rootd, true, 0.0);
-      // Rcout<<"("<<Eroot[l]<<"\n";
       Erhizo[l] = EVanGenuchten(x[l], psiSoil[l], krhizomax[l], nsoil[l], alphasoil[l]);
       fvec[l] = Erhizo[l] - Eroot[l];
-      // Rcout<<" Erhizo"<<l<<": "<< Erhizo[l]<<" Eroot"<<l<<": "<<Eroot[l]<<" fvec: "<<fvec[l]<<"\n";
-      // Rcout<<"der psi_l "<<d_psi_l<<"der Eroot psi_l "<<d_Eroot_psi_l<<"  der psi_root "<<d_psi_root<<"\n";
       Esum +=Eroot[l];
     }
     fvec[nlayers] = Esum-E;
-    // Rcout<<"fvec_nlayers: "<<fvec[nlayers]<<"\n";
     //Fill Jacobian
     for(int l1=0;l1<nlayers;l1++) { //funcio
       for(int l2=0;l2<nlayers;l2++) { //derivada
@@ -466,16 +488,10 @@ List E2psiBelowground(double E, NumericVector psiSoil,
       // funcio nlayers derivada psi_rootcrown
       fjac(nlayers,nlayers) +=-xylemConductance(x[nlayers], krootmax[l], rootc, rootd);
     }
-    // for(int l1=0;l1<=nlayers;l1++) { //funcio
-    //   for(int l2=0;l2<=nlayers;l2++) { //derivada
-    //     Rcout<<fjac(l1,l2)<<" ";
-    //   }
-    //   Rcout<<"\n";
-    // }
     //Check function convergence
     double errf = 0.0;
     for(int fi=0;fi<=nlayers;fi++) errf += std::abs(fvec[fi]);
-    if(errf<=ETol) break;
+    if(errf<=ETol) return(NEWTON_CONVERGED);
     //Right-hand side of linear equations
     for(int fi=0;fi<=nlayers;fi++) p[fi] = -fvec[fi];
     //Solve linear equations using LU decomposition
@@ -483,34 +499,88 @@ List E2psiBelowground(double E, NumericVector psiSoil,
     lubksb(fjac,nlayers+1,indx,p);
     //Check root convergence
     double errx = 0.0;
+    bool stop = false;
     for(int fi=0;fi<=nlayers;fi++) {
       errx +=std::abs(p[fi]);
-      x[fi]+=p[fi];
+      x[fi]+=damping*p[fi];
       x[fi] = std::min(0.0, x[fi]);
       if(x[fi]<-40.0) {
         x[fi] = NA_REAL;
         stop = true;
       }
-      // Rcout<<"("<<x[fi]<<") ";
     }
-    // Rcout<<"\n";
-    if(errx<=psiTol) break;
-    else if(k==(ntrial-1)) { //Last trial and no convergence
-      for(int fi=0;fi<=nlayers;fi++) x[fi] = NA_REAL;
-      // Rcout<<"LC";
-      stop = true;
+    if(stop) return(NEWTON_DIVERGED);
+    if(errx<=psiTol) return(NEWTON_CONVERGED);
+  }
+  return(NEWTON_MAXITER);
+}
+
+/*
+ * Solves the below-ground network for flow E. A first attempt uses the supplied settings and 
+ * initial values. Only if iterations are exhausted, the call is retried once from soil water potentials 
+ * with half Newton steps and twice the number of iterations, before returning missing values.
+ * Divergence is not retried, as it normally means that E cannot be supplied.
+ */
+// [[Rcpp::export("hydraulics_E2psiBelowground")]]
+List E2psiBelowground(double E, NumericVector psiSoil, 
+                  NumericVector krhizomax, NumericVector nsoil, NumericVector alphasoil,
+                  NumericVector krootmax, double rootc, double rootd, 
+                  NumericVector psiIni = NumericVector::create(0),
+                  int ntrial = 10, double psiTol = 0.0001, double ETol = 0.0001) {
+  int nlayers = psiSoil.length();
+  //Initialize
+  NumericVector x(nlayers+1);
+  NumericVector xSoil(nlayers+1);
+  double minPsi = -0.00001;
+  for(int l=0;l<nlayers;l++) {
+    xSoil[l] =psiSoil[l];
+    minPsi = std::min(minPsi, psiSoil[l]);
+  }
+  xSoil[nlayers] = minPsi;
+  if(psiIni.size()==(nlayers+1)){
+    for(int l=0;l<(nlayers+1);l++) {
+      x[l] = psiIni[l];
     }
-    if(stop) break;
+  } else{
+    for(int l=0;l<(nlayers+1);l++) x[l] = xSoil[l];
+  }
+  
+  //Flow across root xylem and rhizosphere elements
+  NumericVector Eroot(nlayers), Erhizo(nlayers);
+  
+  //Newton-Raphson algorithm, with retries only for failing calls
+  int niter = 0;
+  int status = newtonBelowground(E, psiSoil, krhizomax, nsoil, alphasoil, krootmax, rootc, rootd,
+                                 x, Eroot, Erhizo, ntrial, psiTol, ETol, 1.0, niter);
+  double damping = 1.0;
+  int retries = 0;
+  while((status==NEWTON_MAXITER) && (retries < NEWTON_RETRIES)) {
+    retries++;
+    damping = damping*0.5;
+    for(int l=0;l<(nlayers+1);l++) x[l] = xSoil[l];
+    status = newtonBelowground(E, psiSoil, krhizomax, nsoil, alphasoil, krootmax, rootc, rootd,
+                               x, Eroot, Erhizo, 2*ntrial, psiTol, ETol, damping, niter);
+  }
+  bool converged = (status==NEWTON_CONVERGED);
+  if(status==NEWTON_MAXITER) { //Last trial and no convergence
+    for(int fi=0;fi<=nlayers;fi++) x[fi] = NA_REAL;
+  }
+  if(diagnosticsEnabled) {
+    diagnosticsCount(DIAGNOSTICS_NEWTON_ITERATIONS, niter);
+    if(retries>0) diagnosticsCount(DIAGNOSTICS_SOLVER_RETRIES, retries);
+    if((retries>0) && converged) diagnosticsCount(DIAGNOSTICS_SOLVER_RECOVERED);
+    //Divergence marks the end of the supply curve and is not a solver failure
+    if(status==NEWTON_MAXITER) diagnosticsCount(DIAGNOSTICS_BELOWGROUND_NONCONVERGED);
   }
   
   //Initialize and copy output
+  double Esum = 0.0;
   NumericVector psiRhizo(nlayers);
   for(int l=0;l<nlayers;l++) {
     psiRhizo[l] = x[l];
   }
   double psiRootCrown = x[nlayers];
   //Calculate final flows
-  Esum = 0.0;
   for(int l=0;l<(nlayers-1);l++) {
     Erhizo[l] = EVanGenuchten(x[l], psiSoil[l], krhizomax[l], nsoil[l], alphasoil[l]);
     Esum += Erhizo[l];
@@ -1793,6 +1863,7 @@ List supplyFunctionNetworkStem1(NumericVector psiSoil,
       nsteps++;
       if(supplydEdp[i-1]<(pCrit*maxdEdp)) break;
     } else {
+      diagnosticsCount(DIAGNOSTICS_TRUNCATED_SUPPLY);
       break;
     }
   }
@@ -1911,6 +1982,7 @@ List supplyFunctionNetwork(NumericVector psiSoil,
       nsteps++;
       if(supplydEdp[i-1]<(pCrit*maxdEdp)) break;
     } else {
+      diagnosticsCount(DIAGNOSTICS_TRUNCATED_SUPPLY);
       break;
     }
   }
@@ -2205,24 +2277,25 @@ double maximumSoilPlantConductance(NumericVector krhizomax, NumericVector krootm
   return(1.0/(rrhizo+rroot+rstem+rleaf));
 }
 
-// [[Rcpp::export("hydraulics_soilPlantResistances")]]
-NumericVector soilPlantResistances(NumericVector psiSoil, NumericVector psiRhizo, 
-                                   NumericVector psiStem, NumericVector PLCstem,
-                                   double psiLeaf, 
-                                   NumericVector krhizomax, NumericVector n, NumericVector alpha,
-                                   NumericVector krootmax, double rootc, double rootd, 
-                                   double kstemmax, double stemc, double stemd,
-                                   double kleafmax, double leafc, double leafd) {
-  int nlayers = psiSoil.length();
+/*
+ * Soil-plant resistances (rhizosphere, root, stem and leaf) for one step. Soil and rhizosphere
+ * water potentials of layer i are read at 'psiSoil[i*layerStride]' and 'psiRhizo[i*layerStride]',
+ * so that rows of (column-major) matrices can be used directly.
+ */
+void soilPlantResistancesStep(const double* psiSoil, const double* psiRhizo, int nlayers, int layerStride,
+                              const double* psiStem, const double* PLCstem, int nStemSegments,
+                              double psiLeaf, 
+                              NumericVector krhizomax, NumericVector n, NumericVector alpha,
+                              NumericVector krootmax, double rootc, double rootd, 
+                              double kstemmax, double stemc, double stemd,
+                              double kleafmax, double leafc, double leafd,
+                              double* resistances) {
   double krhizo = 0.0;
   double kroot = 0.0;
   for(int i=0;i<nlayers;i++) {
-    krhizo = krhizo + vanGenuchtenConductance(psiSoil[i], krhizomax[i], n[i], alpha[i]);
-    kroot = kroot + xylemConductance(psiRhizo[i], krootmax[i], rootc, rootd);
+    krhizo = krhizo + vanGenuchtenConductance(psiSoil[i*layerStride], krhizomax[i], n[i], alpha[i]);
+    kroot = kroot + xylemConductance(psiRhizo[i*layerStride], krootmax[i], rootc, rootd);
   }
-  double rrhizo = 1.0/krhizo;
-  double rroot = 1.0/kroot;
-  int nStemSegments = psiStem.length();
   double kxsegmax = kstemmax*((double) nStemSegments);
   double rstem = 0.0;
   double plcCond = NA_REAL;
@@ -2230,8 +2303,59 @@ NumericVector soilPlantResistances(NumericVector psiSoil, NumericVector psiRhizo
     plcCond = (1.0-PLCstem[i]);
     rstem = rstem + 1.0/(kxsegmax*std::min(plcCond, xylemConductance(psiStem[i], 1.0, stemc, stemd)));
   }
-  double rleaf = 1.0/xylemConductance(psiLeaf, kleafmax, leafc, leafd);
-  NumericVector resistances = NumericVector::create(rrhizo, rroot, rstem, rleaf);
+  resistances[0] = 1.0/krhizo;
+  resistances[1] = 1.0/kroot;
+  resistances[2] = rstem;
+  resistances[3] = 1.0/xylemConductance(psiLeaf, kleafmax, leafc, leafd);
+}
+
+// [[Rcpp::export("hydraulics_soilPlantResistances")]]
+NumericVector soilPlantResistances(NumericVector psiSoil, NumericVector psiRhizo, 
+                                   NumericVector psiStem, NumericVector PLCstem,
+                                   double psiLeaf, 
+                                   NumericVector krhizomax, NumericVector n, NumericVector alpha,
+                                   NumericVector krootmax, double rootc, double rootd, 
+                                   double kstemmax, double stemc, double stemd,
+                                   double kleafmax, double leafc, double leafd) {
+  NumericVector resistances(4);
+  soilPlantResistancesStep(psiSoil.begin(), psiRhizo.begin(), psiSoil.length(), 1,
+                           psiStem.begin(), PLCstem.begin(), psiStem.length(), psiLeaf,
+                           krhizomax, n, alpha, krootmax, rootc, rootd,
+                           kstemmax, stemc, stemd, kleafmax, leafc, leafd,
+                           resistances.begin());
+  return(resistances);
+}
+
+/*
+ * Soil-plant resistances of one cohort for a series of steps (e.g. days), with 
+ * soil and rhizosphere water potentials in rows of 'psiSoil' and 'psiRhizo' (one column per layer)
+ * and a single stem segment per step
+ */
+// [[Rcpp::export(".soilPlantResistancesSeries")]]
+NumericMatrix soilPlantResistancesSeries(NumericMatrix psiSoil, NumericMatrix psiRhizo, 
+                                         NumericVector psiStem, NumericVector PLCstem,
+                                         NumericVector psiLeaf, 
+                                         NumericVector krhizomax, NumericVector n, NumericVector alpha,
+                                         NumericVector krootmax, double rootc, double rootd, 
+                                         double kstemmax, double stemc, double stemd,
+                                         double kleafmax, double leafc, double leafd, 
+                                         bool relative = false) {
+  int nsteps = psiSoil.nrow();
+  int nlayers = psiSoil.ncol();
+  if((psiRhizo.nrow()!=nsteps) || (psiRhizo.ncol()!=nlayers)) stop("Dimensions of 'psiSoil' and 'psiRhizo' do not match");
+  if((psiStem.size()!=nsteps) || (PLCstem.size()!=nsteps) || (psiLeaf.size()!=nsteps)) stop("Lengths of 'psiStem', 'PLCstem' and 'psiLeaf' should be equal to the number of steps");
+  NumericMatrix resistances(nsteps, 4);
+  double r[4];
+  for(int j=0;j<nsteps;j++) {
+    soilPlantResistancesStep(psiSoil.begin() + j, psiRhizo.begin() + j, nlayers, nsteps,
+                             psiStem.begin() + j, PLCstem.begin() + j, 1, psiLeaf[j],
+                             krhizomax, n, alpha, krootmax, rootc, rootd,
+                             kstemmax, stemc, stemd, kleafmax, leafc, leafd,
+                             r);
+    double rtot = r[0] + r[1] + r[2] + r[3];
+    for(int k=0;k<4;k++) resistances(j,k) = (relative ? 100.0*r[k]/rtot : r[k]);
+  }
+  resistances.attr("dimnames") = List::create(rownames(psiSoil), CharacterVector::create("Rhizosphere", "Root", "Stem", "Leaf"));
   return(resistances);
 }
 
@@ -0,0 +1,248 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <R_ext/Altrep.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace Rcpp;
+
+/**
+ * Binary columnar meteorological files (written by R function writeMeteoBinary)
+ *
+ * Layout (little endian):
+ *  - magic "MEDFMETB" (8 bytes)
+ *  - uint32: byte order marker (0x01020304)
+ *  - int32: version, number of variables, number of days, number of sites
+ *  - int32 x ndays: dates (days since 1970-01-01)
+ *  - char[32] x nvars: variable names (nul-padded)
+ *  - char[64] x nsites: site identifiers (nul-padded)
+ *  - padding to a multiple of 8 bytes
+ *  - double x ndays, for each variable within each site
+ *
+ * Data are accessed through a private memory map that stays open while any column read 
+ * from the file is alive. Columns are returned as ALTREP vectors whose data pointer is 
+ * the mapped series, so that simulation functions read each day directly from the map 
+ * and only the pages of the requested site and period are actually read from disk.
+ */
+const char METEOBINARY_MAGIC[8] = {'M','E','D','F','M','E','T','B'};
+const uint32_t METEOBINARY_BYTEORDER = 0x01020304;
+const int METEOBINARY_HEADER_SIZE = 28;
+const int METEOBINARY_VARNAME_SIZE = 32;
+const int METEOBINARY_SITENAME_SIZE = 64;
+const int METEOBINARY_VERSION = 2;
+
+class MeteoBinaryFile {
+public:
+  int nvars, ndays, nsites;
+  std::vector<std::string> varNames, siteNames;
+
+  MeteoBinaryFile(std::string path) {
+    base = NULL;
+    size = 0;
+#ifndef _WIN32
+    fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) stop("Cannot open file '%s'", path);
+    struct stat sb;
+    if(fstat(fd, &sb) < 0) {
+      close(fd);
+      stop("Cannot read size of file '%s'", path);
+    }
+    size = (size_t) sb.st_size;
+    if(size < METEOBINARY_HEADER_SIZE) {
+      close(fd);
+      stop("File '%s' is not a meteorological binary file", path);
+    }
+    //Private (copy-on-write) mapping: pages written by R would never reach the file
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED) {
+      close(fd);
+      stop("Cannot map file '%s'", path);
+    }
+    base = (char*) p;
+#else
+    //No memory mapping available: read whole file
+    FILE* f = fopen(path.c_str(), "rb");
+    if(f==NULL) stop("Cannot open file '%s'", path);
+    fseek(f, 0, SEEK_END);
+    size = (size_t) ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if(size < METEOBINARY_HEADER_SIZE) {
+      fclose(f);
+      stop("File '%s' is not a meteorological binary file", path);
+    }
+    buffer.resize(size);
+    if(fread(&buffer[0], 1, size, f)!=size) {
+      fclose(f);
+      stop("Cannot read file '%s'", path);
+    }
+    fclose(f);
+    base = &buffer[0];
+#endif
+    if(memcmp(base, METEOBINARY_MAGIC, 8)!=0) {
+      release();
+      stop("File '%s' is not a meteorological binary file", path);
+    }
+    uint32_t byteOrder;
+    memcpy(&byteOrder, base + 8, 4);
+    if(byteOrder!=METEOBINARY_BYTEORDER) {
+      release();
+      stop("Byte order of meteorological binary file '%s' does not match that of this platform", path);
+    }
+    const int* h = (const int*) (base + 12);
+    if(h[0]!=METEOBINARY_VERSION) {
+      release();
+      stop("Unsupported version (%i) of meteorological binary file '%s'", h[0], path);
+    }
+    nvars = h[1];
+    ndays = h[2];
+    nsites = h[3];
+    if((nvars < 0) || (ndays < 0) || (nsites < 0)) {
+      release();
+      stop("File '%s' has a corrupt header", path);
+    }
+    //Check that dates and names lie within the file before reading them
+    size_t off = METEOBINARY_HEADER_SIZE + 4*((size_t) ndays);
+    size_t namesEnd = off + METEOBINARY_VARNAME_SIZE*((size_t) nvars) + METEOBINARY_SITENAME_SIZE*((size_t) nsites);
+    if(size < namesEnd) {
+      release();
+      stop("File '%s' is truncated", path);
+    }
+    for(int v=0;v<nvars;v++) {
+      varNames.push_back(fixedString(base + off, METEOBINARY_VARNAME_SIZE));
+      off += METEOBINARY_VARNAME_SIZE;
+    }
+    for(int s=0;s<nsites;s++) {
+      siteNames.push_back(fixedString(base + off, METEOBINARY_SITENAME_SIZE));
+      off += METEOBINARY_SITENAME_SIZE;
+    }
+    dataOffset = ((off + 7)/8)*8;
+    if(size < dataOffset + 8*((size_t) nsites)*((size_t) nvars)*((size_t) ndays)) {
+      release();
+      stop("File '%s' is truncated", path);
+    }
+  }
+  ~MeteoBinaryFile() {
+    release();
+  }
+  const int* dates() {
+    return((const int*) (base + METEOBINARY_HEADER_SIZE));
+  }
+  // Pointer to the values of variable 'var' for site 'site' (0-based)
+  double* column(int site, int var) {
+    return((double*) (base + dataOffset + 8*((((size_t) site)*nvars + var)*((size_t) ndays))));
+  }
+
+private:
+  char* base;
+  size_t size, dataOffset;
+#ifndef _WIN32
+  int fd;
+#else
+  std::vector<char> buffer;
+#endif
+
+  std::string fixedString(const char* p, int n) {
+    int len = 0;
+    while((len < n) && (p[len]!='\0')) len++;
+    return(std::string(p, len));
+  }
+  void release() {
+#ifndef _WIN32
+    if(base!=NULL) {
+      munmap((void*) base, size);
+      close(fd);
+    }
+#endif
+    base = NULL;
+  }
+};
+
+// [[Rcpp::export(".meteoBinaryInfo")]]
+List meteoBinaryInfo(String file) {
+  MeteoBinaryFile mbf(file.get_cstring());
+  IntegerVector dates(mbf.ndays);
+  const int* d = mbf.dates();
+  for(int i=0;i<mbf.ndays;i++) dates[i] = d[i];
+  CharacterVector variables(mbf.nvars), sites(mbf.nsites);
+  for(int v=0;v<mbf.nvars;v++) variables[v] = mbf.varNames[v];
+  for(int s=0;s<mbf.nsites;s++) sites[s] = mbf.siteNames[s];
+  return(List::create(_["variables"] = variables,
+                      _["dates"] = dates,
+                      _["sites"] = sites));
+}
+
+/**
+ * ALTREP class for the columns of a mapped file. 'data1' is an external pointer to the first
+ * value of the column (protecting the external pointer to the file, so that the map is released 
+ * only when no column uses it) and 'data2' the number of days. Values are not copied: element 
+ * access and data pointers refer to the map, so R and C++ code read each day from the file pages.
+ */
+static R_altrep_class_t meteoBinaryColumnClass;
+
+static double* meteoBinaryColumnValues(SEXP x) {
+  return((double*) R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+static R_xlen_t meteoBinaryColumnLength(SEXP x) {
+  return((R_xlen_t) REAL(R_altrep_data2(x))[0]);
+}
+static void* meteoBinaryColumnDataptr(SEXP x, Rboolean writeable) {
+  return((void*) meteoBinaryColumnValues(x));
+}
+static const void* meteoBinaryColumnDataptrOrNull(SEXP x) {
+  return((const void*) meteoBinaryColumnValues(x));
+}
+static double meteoBinaryColumnElt(SEXP x, R_xlen_t i) {
+  return(meteoBinaryColumnValues(x)[i]);
+}
+static R_xlen_t meteoBinaryColumnGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, double* buf) {
+  R_xlen_t len = meteoBinaryColumnLength(x);
+  R_xlen_t ncopy = std::max((R_xlen_t) 0, std::min(n, len - i));
+  const double* v = meteoBinaryColumnValues(x);
+  std::copy(v + i, v + i + ncopy, buf);
+  return(ncopy);
+}
+static Rboolean meteoBinaryColumnInspect(SEXP x, int pre, int deep, int pvec,
+                                         void (*inspect_subtree)(SEXP, int, int, int)) {
+  Rprintf(" meteorological binary column (%d days)\n", (int) meteoBinaryColumnLength(x));
+  return(TRUE);
+}
+
+// [[Rcpp::init]]
+void meteoBinaryInit(DllInfo* dll) {
+  meteoBinaryColumnClass = R_make_altreal_class("meteoBinaryColumn", "medfate", dll);
+  R_set_altrep_Length_method(meteoBinaryColumnClass, meteoBinaryColumnLength);
+  R_set_altrep_Inspect_method(meteoBinaryColumnClass, meteoBinaryColumnInspect);
+  R_set_altvec_Dataptr_method(meteoBinaryColumnClass, meteoBinaryColumnDataptr);
+  R_set_altvec_Dataptr_or_null_method(meteoBinaryColumnClass, meteoBinaryColumnDataptrOrNull);
+  R_set_altreal_Elt_method(meteoBinaryColumnClass, meteoBinaryColumnElt);
+  R_set_altreal_Get_region_method(meteoBinaryColumnClass, meteoBinaryColumnGetRegion);
+}
+
+// [[Rcpp::export(".meteoBinaryRead")]]
+List meteoBinaryRead(String file, int site, int start, int numDays) {
+  XPtr<MeteoBinaryFile> mbf(new MeteoBinaryFile(file.get_cstring()), true);
+  if((site < 1) || (site > mbf->nsites)) stop("Site index out of range");
+  if((start < 1) || (numDays < 0) || ((start + numDays - 1) > mbf->ndays)) stop("Period out of range");
+  List l(mbf->nvars);
+  CharacterVector variables(mbf->nvars);
+  SEXP len = PROTECT(Rf_ScalarReal((double) numDays));
+  for(int v=0;v<mbf->nvars;v++) {
+    double* col = mbf->column(site - 1, v) + (start - 1);
+    SEXP colPtr = PROTECT(R_MakeExternalPtr((void*) col, R_NilValue, mbf));
+    l[v] = R_new_altrep(meteoBinaryColumnClass, colPtr, len);
+    UNPROTECT(1);
+    variables[v] = mbf->varNames[v];
+  }
+  UNPROTECT(1);
+  l.attr("names") = variables;
+  return(l);
+}
@@ -0,0 +1,199 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <numeric>
+#include <math.h>
+#include "biophysicsutils.h"
+#include <meteoland.h>
+using namespace Rcpp;
+
+/**
+ * Prepares daily and subdaily meteorological forcing for a given site,
+ * so that it can be reused across simulations (spwb, pwb, growth)
+ *
+ * Daily variables are stored in attribute 'forcing' and subdaily variables
+ * in attribute 'subdaily', as matrices of ndailysteps x numDays (i.e. contiguous by day)
+ */
+// [[Rcpp::export(".meteoForcing")]]
+DataFrame meteoForcing(DataFrame meteo, double latitude,
+                       double elevation, double slope, double aspect,
+                       List control) {
+  int ntimesteps = control["ndailysteps"];
+  double defaultWindSpeed = control["defaultWindSpeed"];
+
+  if(NumericVector::is_na(latitude)) stop("Value for 'latitude' should not be missing.");
+  if(NumericVector::is_na(aspect)) aspect = 0.0;
+  if(NumericVector::is_na(slope)) slope = 0.0;
+  double latrad = latitude * (M_PI/180.0);
+  double asprad = aspect * (M_PI/180.0);
+  double slorad = slope * (M_PI/180.0);
+
+  if(!meteo.containsElementNamed("Precipitation")) stop("Please include variable 'Precipitation' in weather input.");
+  NumericVector Precipitation = meteo["Precipitation"];
+  int numDays = Precipitation.size();
+  NumericVector WindSpeed(numDays, NA_REAL);
+  if(meteo.containsElementNamed("WindSpeed")) WindSpeed = meteo["WindSpeed"];
+  IntegerVector JulianDayInput(numDays, NA_INTEGER);
+  if(meteo.containsElementNamed("JulianDay")) JulianDayInput = meteo["JulianDay"];
+
+  //Subdaily forcing (and Penman PET) can only be calculated if all variables are available
+  bool subdaily = (!NumericVector::is_na(elevation)) &&
+    meteo.containsElementNamed("MinTemperature") && meteo.containsElementNamed("MaxTemperature") &&
+    meteo.containsElementNamed("MinRelativeHumidity") && meteo.containsElementNamed("MaxRelativeHumidity") &&
+    meteo.containsElementNamed("Radiation");
+  NumericVector MinTemperature, MaxTemperature, MinRelativeHumidity, MaxRelativeHumidity, Radiation;
+  if(subdaily) {
+    MinTemperature = meteo["MinTemperature"];
+    MaxTemperature = meteo["MaxTemperature"];
+    MinRelativeHumidity = meteo["MinRelativeHumidity"];
+    MaxRelativeHumidity = meteo["MaxRelativeHumidity"];
+    Radiation = meteo["Radiation"];
+  }
+
+  CharacterVector dateStrings = meteo.attr("row.names");
+
+  //Daily forcing
+  IntegerVector DOY(numDays), JulianDay(numDays);
+  NumericVector Photoperiod(numDays), SolarDeclination(numDays), SolarConstant(numDays), PET(numDays, NA_REAL);
+  //Subdaily forcing (one column per day)
+  int nsub = (subdaily ? ntimesteps : 0);
+  int nsubdays = (subdaily ? numDays : 0);
+  NumericMatrix SolarHour(nsub, nsubdays), SolarElevation(nsub, nsubdays);
+  NumericMatrix SWR_direct(nsub, nsubdays), SWR_diffuse(nsub, nsubdays);
+  NumericMatrix PAR_direct(nsub, nsubdays), PAR_diffuse(nsub, nsubdays);
+  NumericMatrix Tatm(nsub, nsubdays), LWR(nsub, nsubdays);
+
+  //Step in seconds
+  double tstep = 86400.0/((double) ntimesteps);
+
+  for(int i=0;i<numDays;i++) {
+    std::string c = as<std::string>(dateStrings[i]);
+    int year = std::atoi(c.substr(0, 4).c_str());
+    int J = JulianDayInput[i];
+    if(IntegerVector::is_na(J)) J = meteoland::radiation_julianDay(year, std::atoi(c.substr(5,2).c_str()),std::atoi(c.substr(8,2).c_str()));
+    int J0101 = meteoland::radiation_julianDay(year,1,1);
+    JulianDay[i] = J;
+    DOY[i] = J - J0101 + 1;
+    double delta = meteoland::radiation_solarDeclination(J);
+    SolarDeclination[i] = delta;
+    SolarConstant[i] = meteoland::radiation_solarConstant(J);
+    Photoperiod[i] = meteoland::radiation_daylength(latrad, 0.0, 0.0, delta);
+
+    if(subdaily) {
+      double tmin = MinTemperature[i];
+      double tmax = MaxTemperature[i];
+      double tmaxPrev = tmax;
+      double tminPrev = tmin;
+      double tminNext = tmin;
+      if(i>0) {
+        tmaxPrev = MaxTemperature[i-1];
+        tminPrev = MinTemperature[i-1];
+      }
+      if(i<(numDays-1)) tminNext = MinTemperature[i+1];
+      double rhmin = MinRelativeHumidity[i];
+      double rhmax = MaxRelativeHumidity[i];
+      double rad = Radiation[i];
+      double prec = Precipitation[i];
+      double wind = WindSpeed[i];
+      if(NumericVector::is_na(wind)) wind = defaultWindSpeed;
+      if(wind<0.1) wind = 0.1;
+      PET[i] = meteoland::penman(latrad, elevation, slorad, asprad, J, tmin, tmax, rhmin, rhmax, rad, wind);
+
+      //Same calculations as in transpirationSperry()
+      double vpatm = meteoland::utils_averageDailyVP(tmin, tmax, rhmin,rhmax);
+      double cloudcover = 0.0;
+      if(prec >0.0) cloudcover = 1.0;
+      bool clearday = (prec==0);
+      DataFrame ddd = meteoland::radiation_directDiffuseDay(SolarConstant[i], latrad, slorad, asprad, delta,
+                                                            rad, clearday, ntimesteps);
+      NumericVector solarHour = ddd["SolarHour"];
+      NumericVector solarElevation = ddd["SolarElevation"];
+      NumericVector swrDirect = ddd["SWR_direct"];
+      NumericVector swrDiffuse = ddd["SWR_diffuse"];
+      NumericVector parDirect = ddd["PAR_direct"];
+      NumericVector parDiffuse = ddd["PAR_diffuse"];
+      double tauday = meteoland::radiation_daylengthseconds(latrad,0.0,0.0, delta);
+      for(int n=0;n<ntimesteps;n++) {
+        SolarHour(n,i) = solarHour[n];
+        SolarElevation(n,i) = solarElevation[n];
+        SWR_direct(n,i) = swrDirect[n];
+        SWR_diffuse(n,i) = swrDiffuse[n];
+        PAR_direct(n,i) = parDirect[n];
+        PAR_diffuse(n,i) = parDiffuse[n];
+        double tsunrise = (solarHour[n]*43200.0/M_PI)+ (tauday/2.0) +(tstep/2.0);
+        Tatm(n,i) = temperatureDiurnalPattern(tsunrise, tmin, tmax, tminPrev, tmaxPrev, tminNext, tauday);
+        LWR(n,i) = meteoland::radiation_skyLongwaveRadiation(Tatm(n,i), vpatm, cloudcover);
+      }
+    }
+  }
+
+  List forcing = List::create(_["DOY"] = DOY, _["JulianDay"] = JulianDay,
+                              _["Photoperiod"] = Photoperiod,
+                              _["SolarDeclination"] = SolarDeclination, _["SolarConstant"] = SolarConstant,
+                              _["PET"] = PET);
+  List subdailyForcing = List::create(_["SolarHour"] = SolarHour, _["SolarElevation"] = SolarElevation,
+                                      _["SWR_direct"] = SWR_direct, _["SWR_diffuse"] = SWR_diffuse,
+                                      _["PAR_direct"] = PAR_direct, _["PAR_diffuse"] = PAR_diffuse,
+                                      _["Tatm"] = Tatm, _["LWR"] = LWR);
+  NumericVector topo = NumericVector::create(latitude, elevation, slope, aspect);
+  topo.attr("names") = CharacterVector::create("latitude", "elevation", "slope", "aspect");
+
+  DataFrame mf = clone(meteo);
+  mf.attr("topography") = topo;
+  mf.attr("ndailysteps") = ntimesteps;
+  mf.attr("forcing") = forcing;
+  mf.attr("subdaily") = subdailyForcing;
+  mf.attr("class") = CharacterVector::create("meteoForcing","data.frame");
+  return(mf);
+}
+
+/**
+ * Checks whether the input meteo is a 'meteoForcing' object compatible with the site
+ * and simulation time steps. Returns false (with a warning) if not compatible.
+ */
+bool isCompatibleMeteoForcing(DataFrame meteo, double latitude, double elevation, double slope, double aspect,
+                              int ntimesteps, bool subdaily) {
+  if(!meteo.inherits("meteoForcing")) return(false);
+  //Attributes are lost when subsetting rows
+  if(!meteo.hasAttribute("forcing") || !meteo.hasAttribute("topography")) {
+    warning("Forcing attributes missing in 'meteo'. Recalculating forcing variables.");
+    return(false);
+  }
+  List forcing = meteo.attr("forcing");
+  IntegerVector DOY = forcing["DOY"];
+  if(DOY.size()!=meteo.nrow()) {
+    warning("Forcing in 'meteo' does not match the number of days. Recalculating forcing variables.");
+    return(false);
+  }
+  NumericVector topo = meteo.attr("topography");
+  if(NumericVector::is_na(aspect)) aspect = 0.0;
+  if(NumericVector::is_na(slope)) slope = 0.0;
+  double lat = topo["latitude"], slo = topo["slope"], asp = topo["aspect"];
+  bool compatible = (lat == latitude) && (slo == slope) && (asp == aspect);
+  if(subdaily) {
+    int nsteps = meteo.attr("ndailysteps");
+    List subdailyForcing = meteo.attr("subdaily");
+    NumericMatrix Tatm = subdailyForcing["Tatm"];
+    double el = topo["elevation"];
+    compatible = compatible && (nsteps == ntimesteps) && (Tatm.ncol() > 0) && (el == elevation);
+  }
+  if(!compatible) warning("Forcing in 'meteo' does not match site topography or 'ndailysteps'. Recalculating forcing variables.");
+  return(compatible);
+}
+
+/**
+ * Extracts the subdaily forcing of a given day (0-based), in the same format as meteoland::radiation_directDiffuseDay()
+ */
+DataFrame meteoForcingDay(List subdailyForcing, int day) {
+  NumericMatrix SolarHour = subdailyForcing["SolarHour"];
+  NumericMatrix SolarElevation = subdailyForcing["SolarElevation"];
+  NumericMatrix SWR_direct = subdailyForcing["SWR_direct"];
+  NumericMatrix SWR_diffuse = subdailyForcing["SWR_diffuse"];
+  NumericMatrix PAR_direct = subdailyForcing["PAR_direct"];
+  NumericMatrix PAR_diffuse = subdailyForcing["PAR_diffuse"];
+  NumericMatrix Tatm = subdailyForcing["Tatm"];
+  NumericMatrix LWR = subdailyForcing["LWR"];
+  return(DataFrame::create(_["SolarHour"] = SolarHour(_,day), _["SolarElevation"] = SolarElevation(_,day),
+                           _["SWR_direct"] = SWR_direct(_,day), _["SWR_diffuse"] = SWR_diffuse(_,day),
+                           _["PAR_direct"] = PAR_direct(_,day), _["PAR_diffuse"] = PAR_diffuse(_,day),
+                           _["Tatm"] = Tatm(_,day), _["LWR"] = LWR(_,day)));
+}
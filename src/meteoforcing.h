@@ -0,0 +1,13 @@
+#include <Rcpp.h>
+
+#ifndef METEOFORCING_H
+#define METEOFORCING_H
+#endif
+using namespace Rcpp;
+
+DataFrame meteoForcing(DataFrame meteo, double latitude,
+                       double elevation, double slope, double aspect,
+                       List control);
+bool isCompatibleMeteoForcing(DataFrame meteo, double latitude, double elevation, double slope, double aspect,
+                              int ntimesteps, bool subdaily);
+DataFrame meteoForcingDay(List subdailyForcing, int day);
@@ -10,6 +10,10 @@
 #include "tissuemoisture.h"
 #include "hydraulics.h"
 #include "stdlib.h"
+#include <set>
+#include <vector>
+#include <string>
+#include <algorithm>
 
 using namespace Rcpp;
 
@@ -1004,6 +1008,128 @@ List forest2growthInput(List x, List soil, DataFrame SpParams, List control) {
   return(growthInput(above,  Z50, Z95, soil, SpParams, control));
 }
 
+/**
+ * Species parameter table restricted to the species present in a set of forest objects 
+ * (one row per species), with missing values imputed once per species. If missing values 
+ * are not to be filled, only parameters that are always imputed are pre-calculated.
+ */
+DataFrame batchSpeciesParams(List forests, DataFrame SpParams, bool fillMissingSpParams) {
+  std::set<int> spSet;
+  for(int f=0;f<forests.size();f++) {
+    List x = forests[f];
+    DataFrame treeData = Rcpp::as<Rcpp::DataFrame>(x["treeData"]);
+    DataFrame shrubData = Rcpp::as<Rcpp::DataFrame>(x["shrubData"]);
+    IntegerVector tSP = treeData["Species"];
+    IntegerVector shSP = shrubData["Species"];
+    for(int i=0;i<tSP.size();i++) spSet.insert(tSP[i]);
+    for(int i=0;i<shSP.size();i++) spSet.insert(shSP[i]);
+  }
+  int nsp = spSet.size();
+  IntegerVector SP(nsp), rows(nsp);
+  int s = 0;
+  for(std::set<int>::iterator it = spSet.begin(); it!=spSet.end(); it++) {
+    SP[s] = *it;
+    rows[s] = findRowIndex(*it, SpParams);
+    s++;
+  }
+  
+  //Parameters imputed from the complete table
+  std::vector<std::string> impNames = imputedParameterNames(true);
+  if(fillMissingSpParams) {
+    std::vector<std::string> fillNames = imputedParameterNames(false);
+    impNames.insert(impNames.end(), fillNames.begin(), fillNames.end());
+  }
+  std::vector<NumericVector> impValues;
+  for(size_t k=0;k<impNames.size();k++) {
+    impValues.push_back(speciesNumericParameterWithImputation(SP, SpParams, impNames[k], true));
+  }
+  
+  //Copy rows of the species present
+  CharacterVector colNames = SpParams.names();
+  int ncol = SpParams.size();
+  std::vector<bool> replaced(impNames.size(), false);
+  List out(ncol);
+  CharacterVector outNames(ncol);
+  for(int j=0;j<ncol;j++) {
+    std::string colName = as<std::string>(colNames[j]);
+    outNames[j] = colName;
+    std::vector<std::string>::iterator it = std::find(impNames.begin(), impNames.end(), colName);
+    if(it!=impNames.end()) {
+      out[j] = impValues[it - impNames.begin()];
+      replaced[it - impNames.begin()] = true;
+      continue;
+    }
+    SEXP col = SpParams[j];
+    if(TYPEOF(col)==REALSXP) {
+      NumericVector v = col;
+      NumericVector vs(nsp);
+      for(int i=0;i<nsp;i++) vs[i] = v[rows[i]];
+      out[j] = vs;
+    } else if(TYPEOF(col)==INTSXP) {
+      IntegerVector v = col;
+      IntegerVector vs(nsp);
+      for(int i=0;i<nsp;i++) vs[i] = v[rows[i]];
+      if(v.hasAttribute("levels")) {
+        vs.attr("levels") = v.attr("levels");
+        vs.attr("class") = v.attr("class");
+      }
+      out[j] = vs;
+    } else if(TYPEOF(col)==LGLSXP) {
+      LogicalVector v = col;
+      LogicalVector vs(nsp);
+      for(int i=0;i<nsp;i++) vs[i] = v[rows[i]];
+      out[j] = vs;
+    } else if(TYPEOF(col)==STRSXP) {
+      CharacterVector v = col;
+      CharacterVector vs(nsp);
+      for(int i=0;i<nsp;i++) vs[i] = v[rows[i]];
+      out[j] = vs;
+    } else {
+      stop("Unsupported type for column '%s' of SpParams", colName);
+    }
+  }
+  //Imputed parameters missing in SpParams are appended
+  for(size_t k=0;k<impNames.size();k++) {
+    if(!replaced[k]) {
+      out.push_back(impValues[k]);
+      outNames.push_back(impNames[k]);
+    }
+  }
+  out.attr("names") = outNames;
+  IntegerVector rowNumbers(nsp);
+  for(int i=0;i<nsp;i++) rowNumbers[i] = i+1;
+  out.attr("row.names") = rowNumbers;
+  out.attr("class") = "data.frame";
+  return(Rcpp::as<Rcpp::DataFrame>(out));
+}
+
+List forest2InputBatch(List forests, List soil, DataFrame SpParams, List control, String mode, bool growthInputs) {
+  int nforests = forests.size();
+  bool sharedSoil = soil.inherits("soil");
+  if(!sharedSoil && (soil.size()!=nforests)) stop("'soil' should be an object of class 'soil' or a list of soil objects of the same length as 'forests'");
+  bool fillMissingSpParams = control["fillMissingSpParams"];
+  DataFrame SpParamsBatch = batchSpeciesParams(forests, SpParams, fillMissingSpParams);
+  List inputs(nforests);
+  for(int f=0;f<nforests;f++) {
+    List x = forests[f];
+    List soil_f = (sharedSoil ? soil : Rcpp::as<Rcpp::List>(soil[f]));
+    if(growthInputs) inputs[f] = forest2growthInput(x, soil_f, SpParamsBatch, control);
+    else inputs[f] = forest2spwbInput(x, soil_f, SpParamsBatch, control, mode);
+  }
+  if(forests.hasAttribute("names")) inputs.attr("names") = forests.attr("names");
+  return(inputs);
+}
+
+// [[Rcpp::export("forest2spwbInputBatch")]]
+List forest2spwbInputBatch(List forests, List soil, DataFrame SpParams, List control, String mode = "MED") {
+  return(forest2InputBatch(forests, soil, SpParams, control, mode, false));
+}
+
+// [[Rcpp::export("forest2growthInputBatch")]]
+List forest2growthInputBatch(List forests, List soil, DataFrame SpParams, List control) {
+  return(forest2InputBatch(forests, soil, SpParams, control, "MED", true));
+}
+
 // [[Rcpp::export("resetInputs")]]
 void resetInputs(List x) {
   List control = x["control"];
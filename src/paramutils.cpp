@@ -3,12 +3,68 @@
 #include <Rcpp.h>
 #include <string.h>
 #include <stdio.h>
+#include <map>
+#include <vector>
+#include <string>
 #include "forestutils.h"
 #include "hydraulics.h"
 #include "tissuemoisture.h"
 using namespace Rcpp;
 
+/**
+ * Species index cache. Dense lookup table from species code (SpIndex) to row in SpParams,
+ * kept between calls and rebuilt whenever a different SpIndex column is used. The column is
+ * preserved while cached, so that its address cannot be reused by another object, and 
+ * lookups are checked against the column values (which may have been modified in place).
+ */
+static SEXP spIndexCacheSEXP = R_NilValue;
+static int spIndexCacheMin = 0;
+static std::vector<int> spIndexCacheRows;
+
+int spIndexValue(SEXP spIndexCol, int i) {
+  if(TYPEOF(spIndexCol)==INTSXP) return(INTEGER(spIndexCol)[i]);
+  double v = REAL(spIndexCol)[i];
+  if(ISNAN(v)) return(NA_INTEGER);
+  return((int) v);
+}
+void buildSpeciesIndex(SEXP spIndexCol) {
+  if(spIndexCacheSEXP!=R_NilValue) R_ReleaseObject(spIndexCacheSEXP);
+  R_PreserveObject(spIndexCol);
+  spIndexCacheSEXP = spIndexCol;
+  int n = Rf_length(spIndexCol);
+  int minSp = NA_INTEGER, maxSp = NA_INTEGER;
+  for(int i=0;i<n;i++) {
+    int sp = spIndexValue(spIndexCol, i);
+    if(sp==NA_INTEGER) continue;
+    if((minSp==NA_INTEGER) || (sp < minSp)) minSp = sp;
+    if((maxSp==NA_INTEGER) || (sp > maxSp)) maxSp = sp;
+  }
+  spIndexCacheRows.clear();
+  spIndexCacheMin = 0;
+  //Dense table unless codes are very sparse (then lookups fall back to linear scans)
+  if((minSp==NA_INTEGER) || (((double) maxSp - (double) minSp) > (10.0*n + 10000.0))) return;
+  spIndexCacheMin = minSp;
+  spIndexCacheRows.assign(maxSp - minSp + 1, -1);
+  for(int i=0;i<n;i++) {
+    int sp = spIndexValue(spIndexCol, i);
+    if(sp==NA_INTEGER) continue;
+    if(spIndexCacheRows[sp - minSp] < 0) spIndexCacheRows[sp - minSp] = i; //Keep first match
+  }
+}
 int findRowIndex(int sp, DataFrame SpParams) {
+  SEXP spIndexCol = SpParams["SpIndex"];
+  if((TYPEOF(spIndexCol)==INTSXP) || (TYPEOF(spIndexCol)==REALSXP)) {
+    //Second attempt rebuilds the index, in case SpIndex was modified in place
+    for(int attempt=0;attempt<2;attempt++) {
+      if((attempt==1) || (spIndexCol!=spIndexCacheSEXP)) buildSpeciesIndex(spIndexCol);
+      if(spIndexCacheRows.size()==0) break;
+      int k = sp - spIndexCacheMin;
+      if((k>=0) && (k < ((int) spIndexCacheRows.size()))) {
+        int row = spIndexCacheRows[k];
+        if((row>=0) && (row < Rf_length(spIndexCol)) && (spIndexValue(spIndexCol, row)==sp)) return(row);
+      }
+    }
+  }
   IntegerVector spIndexSP = SpParams["SpIndex"];
   for(int i=0;i<spIndexSP.length();i++) if(spIndexSP[i]==sp) return(i);
   Rcerr << sp << " not found!\n";
@@ -16,6 +72,31 @@ int findRowIndex(int sp, DataFrame SpParams) {
   return(NA_INTEGER);
 }
 
+/**
+ * Column position cache for SpParams, rebuilt whenever a different names vector is used.
+ * Columns are then accessed by position (without copying them), so that values are never stale.
+ */
+static SEXP spParamsNamesCacheSEXP = R_NilValue;
+static std::map<std::string, int> spParamsColumnCache;
+
+int findColumnIndex(DataFrame SpParams, String parName) {
+  SEXP names = Rf_getAttrib(SpParams, R_NamesSymbol);
+  if(names!=spParamsNamesCacheSEXP) {
+    if(spParamsNamesCacheSEXP!=R_NilValue) R_ReleaseObject(spParamsNamesCacheSEXP);
+    R_PreserveObject(names);
+    spParamsNamesCacheSEXP = names;
+    spParamsColumnCache.clear();
+    for(int j=Rf_length(names)-1;j>=0;j--) spParamsColumnCache[CHAR(STRING_ELT(names, j))] = j; //Keep first match
+  }
+  std::map<std::string, int>::iterator it = spParamsColumnCache.find(parName.get_cstring());
+  if(it==spParamsColumnCache.end()) return(-1);
+  //Check in case names were modified in place
+  if((it->second < Rf_length(names)) && (strcmp(CHAR(STRING_ELT(names, it->second)), parName.get_cstring())==0)) return(it->second);
+  spParamsNamesCacheSEXP = R_NilValue;
+  R_ReleaseObject(names);
+  return(findColumnIndex(SpParams, parName));
+}
+
 // [[Rcpp::export(".checkSpeciesParameters")]]
 void checkSpeciesParameters(DataFrame SpParams, CharacterVector params) {
   NumericVector values;
@@ -31,8 +112,9 @@ void checkSpeciesParameters(DataFrame SpParams, CharacterVector params) {
 
 NumericVector speciesNumericParameter(IntegerVector SP, DataFrame SpParams, String parName){
   NumericVector par(SP.size(), NA_REAL);
-  if(SpParams.containsElementNamed(parName.get_cstring())) {
-    NumericVector parSP = Rcpp::as<Rcpp::NumericVector>(SpParams[parName]);
+  int col = findColumnIndex(SpParams, parName);
+  if(col>=0) {
+    NumericVector parSP = Rcpp::as<Rcpp::NumericVector>(SpParams[col]);
     for(int i=0;i<SP.size();i++) {
       int iSP = findRowIndex(SP[i], SpParams);
       par[i] = parSP[iSP];
@@ -46,8 +128,9 @@ NumericVector speciesNumericParameter(IntegerVector SP, DataFrame SpParams, Stri
 // [[Rcpp::export("species_characterParameter")]]
 CharacterVector speciesCharacterParameter(IntegerVector SP, DataFrame SpParams, String parName){
   CharacterVector par(SP.size(), NA_STRING);
-  if(SpParams.containsElementNamed(parName.get_cstring())) {
-    CharacterVector parSP = SpParams[parName];
+  int col = findColumnIndex(SpParams, parName);
+  if(col>=0) {
+    CharacterVector parSP = SpParams[col];
     for(int i=0;i<SP.size();i++) {
       int iSP = findRowIndex(SP[i], SpParams);
       par[i] = parSP[iSP];
@@ -1258,77 +1341,124 @@ NumericVector treeAllometricCoefficientWithImputation(IntegerVector SP, DataFram
 
 
 
+struct ParameterImputation {
+  const char* name;
+  NumericVector (*imputation)(IntegerVector, DataFrame);
+  NumericVector (*coefficientImputation)(IntegerVector, DataFrame, String);
+  bool alwaysImputed;
+};
+/**
+ * Parameters that can be imputed when missing, with the function used for imputation
+ * (allometric coefficients share a function that receives the parameter name). Parameters
+ * flagged as always imputed are imputed by input builders even when missing values are not 
+ * to be filled.
+ */
+const ParameterImputation parameterImputations[] = {
+  {"kPAR", kPARWithImputation, NULL, false},
+  {"gammaSWR", gammaSWRWithImputation, NULL, false},
+  {"alphaSWR", alphaSWRWithImputation, NULL, false},
+  {"g", gWithImputation, NULL, false},
+  {"r635", fineFoliarRatioWithImputation, NULL, false},
+  {"SLA", specificLeafAreaWithImputation, NULL, false},
+  {"LigninPercent", ligninPercentWithImputation, NULL, false},
+  {"SAV", surfaceToAreaRatioWithImputation, NULL, false},
+  {"HeatContent", heatContentWithImputation, NULL, false},
+  {"pDead", proportionDeadWithImputation, NULL, false},
+  {"LeafWidth", leafWidthWithImputation, NULL, false},
+  {"Ar2Al", Ar2AlWithImputation, NULL, false},
+  {"Al2As", Al2AsWithImputation, NULL, false},
+  {"WoodDensity", woodDensityWithImputation, NULL, false},
+  {"LeafDensity", leafDensityWithImputation, NULL, false},
+  {"FineRootDensity", fineRootDensityWithImputation, NULL, false},
+  {"SRL", specificRootLengthWithImputation, NULL, false},
+  {"RLD", rootLengthDensityWithImputation, NULL, false},
+  {"conduit2sapwood", conduit2sapwoodWithImputation, NULL, false},
+  {"StemPI0", stemPI0WithImputation, NULL, false},
+  {"StemEPS", stemEPSWithImputation, NULL, false},
+  {"StemAF", stemAFWithImputation, NULL, false},
+  {"LeafPI0", leafPI0WithImputation, NULL, false},
+  {"LeafEPS", leafEPSWithImputation, NULL, false},
+  {"LeafAF", leafAFWithImputation, NULL, false},
+  {"pRootDisc", pRootDiscWithImputation, NULL, false},
+  {"Tmax_LAI", TmaxLAIWithImputation, NULL, true},
+  {"Tmax_LAIsq", TmaxLAIsqWithImputation, NULL, true},
+  {"WUE", WUEWithImputation, NULL, false},
+  {"WUE_decay", WUEDecayWithImputation, NULL, true},
+  {"Psi_Critic", psiCriticWithImputation, NULL, false},
+  {"Psi_Extract", psiExtractWithImputation, NULL, false},
+  {"Kmax_stemxylem", KmaxStemXylemWithImputation, NULL, false},
+  {"Kmax_rootxylem", KmaxRootXylemWithImputation, NULL, false},
+  {"VCleaf_kmax", VCleafkmaxWithImputation, NULL, false},
+  {"Gswmax", GswmaxWithImputation, NULL, false},
+  {"Gswmin", GswminWithImputation, NULL, false},
+  {"Nleaf", NleafWithImputation, NULL, false},
+  {"Nsapwood", NsapwoodWithImputation, NULL, false},
+  {"Nfineroot", NfinerootWithImputation, NULL, false},
+  {"RERleaf", LeafRespirationRateWithImputation, NULL, true},
+  {"RERsapwood", SapwoodRespirationRateWithImputation, NULL, true},
+  {"RERfineroot", FinerootRespirationRateWithImputation, NULL, true},
+  {"Vmax298", Vmax298WithImputation, NULL, false},
+  {"Jmax298", Jmax298WithImputation, NULL, false},
+  {"VCstem_c", VCstemCWithImputation, NULL, false},
+  {"VCstem_d", VCstemDWithImputation, NULL, false},
+  {"VCleaf_c", VCleafCWithImputation, NULL, false},
+  {"VCleaf_d", VCleafDWithImputation, NULL, false},
+  {"VCroot_c", VCrootCWithImputation, NULL, false},
+  {"VCroot_d", VCrootDWithImputation, NULL, false},
+  {"WoodC", WoodCWithImputation, NULL, false},
+  {"LeafDuration", leafDurationWithImputation, NULL, false},
+  {"t0gdd", t0gddWithImputation, NULL, false},
+  {"Sgdd", SgddWithImputation, NULL, false},
+  {"Tbgdd", TbgddWithImputation, NULL, false},
+  {"Ssen", SsenWithImputation, NULL, false},
+  {"Phsen", PhsenWithImputation, NULL, false},
+  {"Tbsen", TbsenWithImputation, NULL, false},
+  {"xsen", xsenWithImputation, NULL, false},
+  {"ysen", ysenWithImputation, NULL, false},
+  {"a_fbt", NULL, treeAllometricCoefficientWithImputation, false},
+  {"b_fbt", NULL, treeAllometricCoefficientWithImputation, false},
+  {"c_fbt", NULL, treeAllometricCoefficientWithImputation, false},
+  {"d_fbt", NULL, treeAllometricCoefficientWithImputation, false},
+  {"a_cw", NULL, treeAllometricCoefficientWithImputation, false},
+  {"b_cw", NULL, treeAllometricCoefficientWithImputation, false},
+  {"a_cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"b_1cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"b_2cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"b_3cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"c_1cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"c_2cr", NULL, treeAllometricCoefficientWithImputation, false},
+  {"a_ash", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"b_ash", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"a_bsh", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"b_bsh", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"a_btsh", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"b_btsh", NULL, shrubAllometricCoefficientWithImputation, false},
+  {"cr", NULL, shrubAllometricCoefficientWithImputation, false}
+};
+const int numParameterImputations = sizeof(parameterImputations)/sizeof(ParameterImputation);
+
+/**
+ * Names of imputable parameters that are always imputed by input builders ('alwaysImputed = true') or only
+ * when missing values are to be filled ('alwaysImputed = false')
+ */
+std::vector<std::string> imputedParameterNames(bool alwaysImputed) {
+  std::vector<std::string> names;
+  for(int i=0;i<numParameterImputations;i++) {
+    if(parameterImputations[i].alwaysImputed==alwaysImputed) names.push_back(parameterImputations[i].name);
+  }
+  return(names);
+}
+
 // [[Rcpp::export("species_parameter")]]
 NumericVector speciesNumericParameterWithImputation(IntegerVector SP, DataFrame SpParams, String parName, bool fillMissing = true){
   if(fillMissing) {
-    if(parName == "kPAR") return(kPARWithImputation(SP,SpParams));
-    else if(parName == "gammaSWR") return(gammaSWRWithImputation(SP,SpParams));
-    else if(parName == "alphaSWR") return(alphaSWRWithImputation(SP,SpParams));
-    else if(parName == "g") return(gWithImputation(SP,SpParams));
-    else if(parName == "r635") return(fineFoliarRatioWithImputation(SP,SpParams));
-    else if(parName == "SLA") return(specificLeafAreaWithImputation(SP,SpParams));
-    else if(parName == "LigninPercent") return(ligninPercentWithImputation(SP, SpParams));
-    else if(parName == "SAV") return(surfaceToAreaRatioWithImputation(SP, SpParams));
-    else if(parName == "HeatContent") return(heatContentWithImputation(SP, SpParams));
-    else if(parName == "pDead") return(proportionDeadWithImputation(SP,SpParams));
-    else if(parName == "LeafWidth") return(leafWidthWithImputation(SP, SpParams));
-    else if(parName == "Ar2Al") return(Ar2AlWithImputation(SP, SpParams));
-    else if(parName == "Al2As") return(Al2AsWithImputation(SP, SpParams));
-    else if(parName == "WoodDensity") return(woodDensityWithImputation(SP, SpParams));
-    else if(parName == "LeafDensity") return(leafDensityWithImputation(SP, SpParams));
-    else if(parName == "FineRootDensity") return(fineRootDensityWithImputation(SP, SpParams));
-    else if(parName == "SRL") return(specificRootLengthWithImputation(SP, SpParams));
-    else if(parName == "RLD") return(rootLengthDensityWithImputation(SP, SpParams));
-    else if(parName == "conduit2sapwood") return(conduit2sapwoodWithImputation(SP, SpParams));
-    else if(parName == "StemPI0") return(stemPI0WithImputation(SP, SpParams));
-    else if(parName == "StemEPS") return(stemEPSWithImputation(SP, SpParams));
-    else if(parName == "StemAF") return(stemAFWithImputation(SP, SpParams));
-    else if(parName == "LeafPI0") return(leafPI0WithImputation(SP, SpParams));
-    else if(parName == "LeafEPS") return(leafEPSWithImputation(SP, SpParams));
-    else if(parName == "LeafAF") return(leafAFWithImputation(SP, SpParams));
-    else if(parName == "pRootDisc") return(pRootDiscWithImputation(SP, SpParams));
-    else if(parName == "Tmax_LAI") return(TmaxLAIWithImputation(SP, SpParams));
-    else if(parName == "Tmax_LAIsq") return(TmaxLAIsqWithImputation(SP, SpParams));
-    else if(parName == "WUE") return(WUEWithImputation(SP, SpParams));
-    else if(parName == "WUE_decay") return(WUEDecayWithImputation(SP, SpParams));
-    else if(parName == "Psi_Critic") return(psiCriticWithImputation(SP, SpParams));
-    else if(parName == "Psi_Extract") return(psiExtractWithImputation(SP, SpParams));
-    else if(parName == "Kmax_stemxylem") return(KmaxStemXylemWithImputation(SP, SpParams));
-    else if(parName == "Kmax_rootxylem") return(KmaxRootXylemWithImputation(SP, SpParams));
-    else if(parName == "VCleaf_kmax") return(VCleafkmaxWithImputation(SP, SpParams));
-    else if(parName == "Gswmax") return(GswmaxWithImputation(SP, SpParams));
-    else if(parName == "Gswmin") return(GswminWithImputation(SP, SpParams));
-    else if(parName == "Nleaf") return(NleafWithImputation(SP, SpParams));
-    else if(parName == "Nsapwood") return(NsapwoodWithImputation(SP, SpParams));
-    else if(parName == "Nfineroot") return(NfinerootWithImputation(SP, SpParams));
-    else if(parName == "RERleaf") return(LeafRespirationRateWithImputation(SP, SpParams));
-    else if(parName == "RERsapwood") return(SapwoodRespirationRateWithImputation(SP, SpParams));
-    else if(parName == "RERfineroot") return(FinerootRespirationRateWithImputation(SP, SpParams));
-    else if(parName == "Vmax298") return(Vmax298WithImputation(SP, SpParams));
-    else if(parName == "Jmax298") return(Jmax298WithImputation(SP, SpParams));
-    else if(parName == "VCstem_c") return(VCstemCWithImputation(SP, SpParams));
-    else if(parName == "VCstem_d") return(VCstemDWithImputation(SP, SpParams));
-    else if(parName == "VCleaf_c") return(VCleafCWithImputation(SP, SpParams));
-    else if(parName == "VCleaf_d") return(VCleafDWithImputation(SP, SpParams));
-    else if(parName == "VCroot_c") return(VCrootCWithImputation(SP, SpParams));
-    else if(parName == "VCroot_d") return(VCrootDWithImputation(SP, SpParams));
-    else if(parName == "WoodC") return(WoodCWithImputation(SP, SpParams));
-    else if(parName == "LeafDuration") return(leafDurationWithImputation(SP, SpParams));
-    else if(parName == "t0gdd") return(t0gddWithImputation(SP, SpParams));
-    else if(parName == "Sgdd") return(SgddWithImputation(SP, SpParams));
-    else if(parName == "Tbgdd") return(TbgddWithImputation(SP, SpParams));
-    else if(parName == "Ssen") return(SsenWithImputation(SP, SpParams));
-    else if(parName == "Phsen") return(PhsenWithImputation(SP, SpParams));
-    else if(parName == "Tbsen") return(TbsenWithImputation(SP, SpParams));
-    else if(parName == "xsen") return(xsenWithImputation(SP, SpParams));
-    else if(parName == "ysen") return(ysenWithImputation(SP, SpParams));
-    else if((parName == "a_fbt") | (parName == "b_fbt")| (parName == "c_fbt")| (parName == "d_fbt")) return(treeAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "a_cw") | (parName == "b_cw")) return(treeAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "a_cr") | (parName == "b_1cr")| (parName == "b_2cr")| (parName == "b_3cr")) return(treeAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "c_1cr")| (parName == "c_2cr")) return(treeAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "a_ash")| (parName == "b_ash")) return(shrubAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "a_bsh")| (parName == "b_bsh")) return(shrubAllometricCoefficientWithImputation(SP, SpParams, parName));
-    else if((parName == "a_btsh")| (parName == "b_btsh")| (parName == "cr")) return(shrubAllometricCoefficientWithImputation(SP, SpParams, parName));
+    for(int i=0;i<numParameterImputations;i++) {
+      const ParameterImputation& imp = parameterImputations[i];
+      if(parName == imp.name) {
+        if(imp.coefficientImputation!=NULL) return(imp.coefficientImputation(SP, SpParams, parName));
+        return(imp.imputation(SP, SpParams));
+      }
+    }
   }
   return(speciesNumericParameter(SP, SpParams,parName));
 }
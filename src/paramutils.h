@@ -13,5 +13,6 @@ CharacterVector speciesCharacterParameter(IntegerVector SP, DataFrame SpParams,
 NumericVector cohortNumericParameter(List x, DataFrame SpParams, String parName);
 CharacterVector cohortCharacterParameter(List x, DataFrame SpParams, String parName);
 
+std::vector<std::string> imputedParameterNames(bool alwaysImputed);
 NumericVector speciesNumericParameterWithImputation(IntegerVector SP, DataFrame SpParams, String parName, bool fillMissing = true);
 NumericVector cohortNumericParameterWithImputation(List x, DataFrame SpParams, String parName, bool fillMissing = true);
@@ -2,6 +2,7 @@
 #include <numeric>
 #include <math.h>
 #include "biophysicsutils.h"
+#include "diagnostics.h"
 #include <meteoland.h>
 using namespace Rcpp;
 
@@ -159,9 +160,12 @@ double fder(double x, double Q, double Ca, double Gc, double GT, double Km, doub
  * Vmax298 - maximum Rubisco carboxylation rate per leaf area at 298 ºK (i.e. 25 ºC) (micromol*s-1*m-2) 
  * 
  * return units: micromol*s-1*m-2
+ * 
+ * Intercellular CO2 concentration and assimilation are returned through 'Ci' and 'A', so that 
+ * photosynthesis functions do not allocate an R vector for each flow step.
  */
-// [[Rcpp::export("photo_photosynthesis")]]
-NumericVector leafphotosynthesis(double Q, double Catm, double Gc, double Tleaf, double Vmax298, double Jmax298, bool verbose=false) {
+void leafphotosynthesisNative(double Q, double Catm, double Gc, double Tleaf, double Vmax298, double Jmax298, 
+                              double &Ci, double &A, bool verbose = false) {
   //Corrections per leaf temperature
   double GT = gammaTemp(Tleaf);
   double Km = KmTemp(Tleaf, O2_conc);
@@ -181,8 +185,33 @@ NumericVector leafphotosynthesis(double Q, double Catm, double Gc, double Tleaf,
     cnt++;
     if(verbose) Rcout<<x<<"     "<<x1<<"           "<<std::abs(x1-x)<<"\n";        
   } while ((std::abs(x1-x)>=e) & (cnt < mxiter));
-  double A = photosynthesis_Ci(Q,x1,GT,Km,Vmax,Jmax);
-  NumericVector res = NumericVector::create(x1, A);
+  //If Newton-Raphson did not converge or left [0, Catm], use bisection when the root is bracketed 
+  //in that interval. Missing values (e.g. without light) are returned as before
+  if(!NumericVector::is_na(x1) && ((std::abs(x1-x)>=e) || (x1 < 0.0) || (x1 > Catm))) {
+    diagnosticsCount(DIAGNOSTICS_SOLVER_RETRIES);
+    double a = 0.0, b = Catm;
+    double fa = f(a, Q, Catm, Gc, GT, Km, Vmax, Jmax);
+    double fb = f(b, Q, Catm, Gc, GT, Km, Vmax, Jmax);
+    if((fa <= 0.0) && (fb >= 0.0)) {
+      for(int i=0;(i<100) && ((b-a)>=e);i++) {
+        double m = 0.5*(a+b);
+        if(f(m, Q, Catm, Gc, GT, Km, Vmax, Jmax) > 0.0) b = m;
+        else a = m;
+      }
+      if((b-a) < e) {
+        x1 = 0.5*(a+b);
+        diagnosticsCount(DIAGNOSTICS_SOLVER_RECOVERED);
+      }
+    }
+  }
+  Ci = x1;
+  A = photosynthesis_Ci(Q,x1,GT,Km,Vmax,Jmax);
+}
+// [[Rcpp::export("photo_photosynthesis")]]
+NumericVector leafphotosynthesis(double Q, double Catm, double Gc, double Tleaf, double Vmax298, double Jmax298, bool verbose=false) {
+  double Ci, A;
+  leafphotosynthesisNative(Q, Catm, Gc, Tleaf, Vmax298, Jmax298, Ci, A, verbose);
+  NumericVector res = NumericVector::create(Ci, A);
   res.attr("names") = CharacterVector::create("Ci", "A");
   return(res);
 }
@@ -209,9 +238,7 @@ DataFrame leafPhotosynthesisFunction(NumericVector E, NumericVector psiLeaf, dou
     Gbw = 0.397*pow(u/(leafWidth*0.0072), 0.5); // mol boundary layer conductance
     Gwdiff = std::min(Gwdiff, Gbw); //Diffusive conductance cannot be lower than boundary layer conductance
     Gsw[i]  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
-    NumericVector LP = leafphotosynthesis(Q/refLeafArea, Catm, Gwdiff/1.6, std::max(0.0,leafTemp[i]), Vmax298/refLeafArea, Jmax298/refLeafArea);
-    Ci[i] = LP[0];
-    Ag[i] = LP[1];
+    leafphotosynthesisNative(Q/refLeafArea, Catm, Gwdiff/1.6, std::max(0.0,leafTemp[i]), Vmax298/refLeafArea, Jmax298/refLeafArea, Ci[i], Ag[i]);
     An[i] = Ag[i] - 0.015*VmaxTemp(Vmax298/refLeafArea, leafTemp[i]);
   }
   return(DataFrame::create(Named("LeafTemperature") = leafTemp,
@@ -221,15 +248,17 @@ DataFrame leafPhotosynthesisFunction(NumericVector E, NumericVector psiLeaf, dou
                       Named("GrossPhotosynthesis") = Ag,
                       Named("NetPhotosynthesis") = An));
 }
-// [[Rcpp::export("photo_leafPhotosynthesisFunction2")]]
-DataFrame leafPhotosynthesisFunction2(NumericVector E, NumericVector psiLeaf, double Catm, double Patm, double Tair, double vpa, double u, 
-                                     double SWRabs, double LWRnet, double Q, double Vmax298, double Jmax298, 
-                                     double leafWidth = 1.0, double refLeafArea = 1.0, bool verbose = false) {
-  int nsteps = E.size();
-  NumericVector leafTemp(nsteps);
-  NumericVector leafVPD(nsteps);
-  NumericVector Gsw(nsteps), Ci(nsteps);
-  NumericVector Ag(nsteps), An(nsteps);
+/**
+ * Native version of leafPhotosynthesisFunction2(), writing the photosynthesis function for the 'nsteps' flow 
+ * values of 'E' into the supplied buffers (of length 'nsteps'). Used by transpirationSperry() for each cohort 
+ * and time step with scratch memory, so that the photosynthesis functions are not R objects.
+ */
+void leafPhotosynthesisFunction2Native(const double* E, const double* psiLeaf, int nsteps,
+                                       double Catm, double Patm, double Tair, double vpa, double u, 
+                                       double SWRabs, double LWRnet, double Q, double Vmax298, double Jmax298, 
+                                       double leafWidth, double refLeafArea,
+                                       double* leafTemp, double* leafVPD, double* Gsw, 
+                                       double* Ci, double* Ag, double* An) {
   double Gwdiff, Gbw;
   // Rcout <<refLeafArea<<" "<<SWRabs/refLeafArea<< " "<< LWRnet/refLeafArea << "  "<<Tair<< " "<<u<<"\n";
   for(int i=0;i<nsteps;i++){
@@ -243,11 +272,23 @@ DataFrame leafPhotosynthesisFunction2(NumericVector E, NumericVector psiLeaf, do
     Gbw = 0.397*pow(u/(leafWidth*0.0072), 0.5); // mol boundary layer conductance
     Gwdiff = std::min(Gwdiff, Gbw); //Diffusive conductance cannot be lower than boundary layer conductance
     Gsw[i]  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
-    NumericVector LP = leafphotosynthesis(Q/refLeafArea, Catm, Gwdiff/1.6, std::max(0.0,leafTemp[i]), Vmax298/refLeafArea, Jmax298/refLeafArea);
-    Ci[i] = LP[0];
-    Ag[i] = LP[1];
+    leafphotosynthesisNative(Q/refLeafArea, Catm, Gwdiff/1.6, std::max(0.0,leafTemp[i]), Vmax298/refLeafArea, Jmax298/refLeafArea, Ci[i], Ag[i]);
     An[i] = Ag[i] - 0.015*VmaxTemp(Vmax298/refLeafArea, leafTemp[i]);
   }
+}
+// [[Rcpp::export("photo_leafPhotosynthesisFunction2")]]
+DataFrame leafPhotosynthesisFunction2(NumericVector E, NumericVector psiLeaf, double Catm, double Patm, double Tair, double vpa, double u, 
+                                     double SWRabs, double LWRnet, double Q, double Vmax298, double Jmax298, 
+                                     double leafWidth = 1.0, double refLeafArea = 1.0, bool verbose = false) {
+  int nsteps = E.size();
+  NumericVector leafTemp(nsteps);
+  NumericVector leafVPD(nsteps);
+  NumericVector Gsw(nsteps), Ci(nsteps);
+  NumericVector Ag(nsteps), An(nsteps);
+  leafPhotosynthesisFunction2Native(E.begin(), psiLeaf.begin(), nsteps, Catm, Patm, Tair, vpa, u,
+                                    SWRabs, LWRnet, Q, Vmax298, Jmax298, leafWidth, refLeafArea,
+                                    leafTemp.begin(), leafVPD.begin(), Gsw.begin(), 
+                                    Ci.begin(), Ag.begin(), An.begin());
   return(DataFrame::create(Named("LeafTemperature") = leafTemp,
                            Named("LeafVPD") = leafVPD,
                            Named("Gsw") = Gsw,
@@ -312,9 +353,7 @@ DataFrame sunshadePhotosynthesisFunction(NumericVector E, NumericVector psiLeaf,
     Gsw  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
     Gwdiff = Gwdiff*SLarea; //From Gwdiff per leaf area to Gwdiff per ground area
     if(QSL>0.0) {
-      NumericVector LP = leafphotosynthesis(QSL, Catm, Gwdiff/1.6, leafT, Vmax298SL, Jmax298SL);//Call photosynthesis with aggregated values
-      leafCiSL[i] = LP[0];
-      Agj = LP[1];
+      leafphotosynthesisNative(QSL, Catm, Gwdiff/1.6, leafT, Vmax298SL, Jmax298SL, leafCiSL[i], Agj);//Call photosynthesis with aggregated values
       Anj = Agj - 0.015*VmaxTemp(Vmax298SL, leafT);
       Ag[i]+=Agj;
       An[i]+=Anj;
@@ -335,9 +374,7 @@ DataFrame sunshadePhotosynthesisFunction(NumericVector E, NumericVector psiLeaf,
     Gsw  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
     Gwdiff = Gwdiff*SLarea; //From Gwdiff per leaf area to Gwdiff per ground area
     if(QSH>0.0) {
-      NumericVector LP = leafphotosynthesis(QSH, Catm, Gwdiff/1.6, leafT, Vmax298SH, Jmax298SH); //Call photosynthesis with aggregated values
-      leafCiSH[i] = LP[0];
-      Agj = LP[1];
+      leafphotosynthesisNative(QSH, Catm, Gwdiff/1.6, leafT, Vmax298SH, Jmax298SH, leafCiSH[i], Agj); //Call photosynthesis with aggregated values
       Anj = Agj - 0.015*VmaxTemp(Vmax298SH, leafT);
       Ag[i]+=Agj;
       An[i]+=Anj;
@@ -365,7 +402,7 @@ DataFrame multilayerPhotosynthesisFunction(NumericVector E, NumericVector psiLea
   int nsteps = E.size();
   int nlayers = SLarea.size();
   NumericVector Ag(nsteps,0.0), An(nsteps,0.0);
-  double leafT,leafVPD, Gwdiff, Gsw, Gbw, Agj, Anj;
+  double leafT,leafVPD, Gwdiff, Gsw, Gbw, Cij, Agj, Anj;
   for(int i=0;i<nsteps;i++){
     Ag[i]=0.0;
     An[i]=0.0;
@@ -382,8 +419,7 @@ DataFrame multilayerPhotosynthesisFunction(NumericVector E, NumericVector psiLea
       Gwdiff = std::min(Gwdiff, Gbw); //Diffusive conductance cannot be lower than boundary layer conductance
       Gsw  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
       if(QSL[j]>0.0) {
-        NumericVector LP = leafphotosynthesis(QSL[j], Catm, Gwdiff/1.6, leafT, Vmax298[j], Jmax298[j]);
-        Agj = LP[1];
+        leafphotosynthesisNative(QSL[j], Catm, Gwdiff/1.6, leafT, Vmax298[j], Jmax298[j], Cij, Agj);
         Anj = Agj - 0.015*VmaxTemp(Vmax298[j], leafT);
         //From A per leaf area to A per ground area
         Ag[i]+=Agj*SLarea[j];
@@ -401,8 +437,7 @@ DataFrame multilayerPhotosynthesisFunction(NumericVector E, NumericVector psiLea
       Gwdiff = std::min(Gwdiff, Gbw); //Diffusive conductance cannot be lower than boundary layer conductance
       Gsw  = std::abs(1.0/((1.0/Gwdiff) - (1.0/Gbw))); //Determine stomatal conductance after accounting for leaf boundary conductance
       if(QSH[j]>0.0) {
-        NumericVector LP = leafphotosynthesis(QSH[j], Catm, Gwdiff/1.6, leafT, Vmax298[j], Jmax298[j]);
-        Agj = LP[1];
+        leafphotosynthesisNative(QSH[j], Catm, Gwdiff/1.6, leafT, Vmax298[j], Jmax298[j], Cij, Agj);
         Anj = Agj - 0.015*VmaxTemp(Vmax298[j], leafT);
         Ag[i]+=Agj*SHarea[j];
         An[i]+=Anj*SHarea[j];
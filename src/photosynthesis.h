@@ -14,6 +14,12 @@ DataFrame leafPhotosynthesisFunction(NumericVector E, NumericVector psiLeaf, dou
                                      double absRad, double Q, double Vmax298, double Jmax298, 
                                      double leafWidth = 1.0, double refLeafArea = 1.0, bool verbose = false);
 
+void leafPhotosynthesisFunction2Native(const double* E, const double* psiLeaf, int nsteps,
+                                       double Catm, double Patm, double Tair, double vpa, double u, 
+                                       double SWRabs, double LWRnet, double Q, double Vmax298, double Jmax298, 
+                                       double leafWidth, double refLeafArea,
+                                       double* leafTemp, double* leafVPD, double* Gsw, 
+                                       double* Ci, double* Ag, double* An);
 DataFrame leafPhotosynthesisFunction2(NumericVector E, NumericVector psiLeaf, double Catm, double Patm, double Tair, double vpa, double u, 
                                      double SWRabs, double LWRnet, double Q, double Vmax298, double Jmax298, 
                                      double leafWidth = 1.0, double refLeafArea = 1.0, bool verbose = false);
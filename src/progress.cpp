@@ -0,0 +1,162 @@
+#define STRICT_R_HEADERS
+#include <Rcpp.h>
+#include <vector>
+#include "progress.h"
+using namespace Rcpp;
+
+/**
+ * Cooperative progress reporting and cancellation of daily simulation loops.
+ * 
+ * Simulation functions poll 'simulationCancelled' every 'progressInterval' days. 
+ * A run is cancelled (returning the results of the days already simulated) when:
+ *  - the user interrupts R (checked without a long jump out of C++ code);
+ *  - the R function 'progressFunction' in the control list returns FALSE;
+ *  - 'requestSimulationCancel' was called without a token during the run (e.g. from its 'progressFunction');
+ *  - the cancellation token given as 'cancelToken' in the control list has been cancelled.
+ * Requests without a token belong to the innermost running simulation and are dropped when it ends, 
+ * so that they never affect other runs. Tokens are owned by the caller and are never cleared, so that 
+ * drivers running several simulations with the same control (e.g. fordyn) also see them.
+ * Daily outputs of cancelled runs are truncated to the days actually simulated.
+ */
+static std::vector<bool> runCancelRequests;
+
+SimulationRun::SimulationRun() {
+  runCancelRequests.push_back(false);
+}
+SimulationRun::~SimulationRun() {
+  runCancelRequests.pop_back();
+}
+
+// [[Rcpp::export("simulationCancelToken")]]
+Environment simulationCancelToken() {
+  Environment token = Environment::empty_env().new_child(false);
+  token.assign("cancelled", false);
+  return(token);
+}
+
+// [[Rcpp::export("requestSimulationCancel")]]
+void requestSimulationCancel(SEXP token = R_NilValue) {
+  if(!Rf_isNull(token)) {
+    if(!Rf_isEnvironment(token)) stop("'token' should be a cancellation token created with 'simulationCancelToken'");
+    Environment(token).assign("cancelled", true);
+  } else if(runCancelRequests.size() > 0) {
+    runCancelRequests.back() = true;
+  }
+}
+
+bool simulationCancelRequested(List control) {
+  if(!control.containsElementNamed("cancelToken")) return(false);
+  SEXP token = control["cancelToken"];
+  if(!Rf_isEnvironment(token)) return(false);
+  SEXP cancelled = Rf_findVarInFrame(token, Rf_install("cancelled"));
+  if(cancelled == R_UnboundValue) return(false);
+  return(Rf_asLogical(cancelled)==TRUE);
+}
+
+static void checkInterruptFunction(void* dummy) {
+  R_CheckUserInterrupt();
+}
+
+int progressInterval(List control) {
+  if(!control.containsElementNamed("progressInterval")) return(10);
+  SEXP pi = control["progressInterval"];
+  if(Rf_isNull(pi)) return(0);
+  int n = Rcpp::as<int>(pi);
+  if(IntegerVector::is_na(n) || (n < 0)) return(0);
+  return(n);
+}
+
+bool simulationCancelled(List control, int day, int numDays) {
+  if(!R_ToplevelExec(checkInterruptFunction, NULL)) return(true);
+  if(control.containsElementNamed("progressFunction")) {
+    SEXP pf = control["progressFunction"];
+    if(!Rf_isNull(pf)) {
+      Function progressFunction(pf);
+      LogicalVector res = progressFunction(day, numDays);
+      if((res.size() > 0) && (res[0] == 0)) return(true);
+    }
+  }
+  //Requests (possibly made by the progress function) of this run or its token
+  if((runCancelRequests.size() > 0) && runCancelRequests.back()) return(true);
+  return(simulationCancelRequested(control));
+}
+
+/**
+ * First 'n' elements of a vector (names, factor levels and class are kept)
+ */
+SEXP headElements(SEXP v, int n) {
+  SEXP out = PROTECT(Rf_lengthgets(v, n));
+  SEXP levels = Rf_getAttrib(v, R_LevelsSymbol);
+  if(!Rf_isNull(levels)) Rf_setAttrib(out, R_LevelsSymbol, levels);
+  SEXP cls = Rf_getAttrib(v, R_ClassSymbol);
+  if(!Rf_isNull(cls)) Rf_setAttrib(out, R_ClassSymbol, cls);
+  UNPROTECT(1);
+  return(out);
+}
+
+/**
+ * First 'n' rows of a numeric matrix (row names are truncated accordingly)
+ */
+SEXP headRows(NumericMatrix m, int n) {
+  NumericMatrix mt(n, m.ncol());
+  for(int i=0;i<n;i++) mt(i,_) = m(i,_);
+  if(m.hasAttribute("dimnames")) {
+    List dn = m.attr("dimnames");
+    SEXP rn = dn[0];
+    mt.attr("dimnames") = List::create(Rf_isNull(rn) ? rn : headElements(rn, n), dn[1]);
+  }
+  return(mt);
+}
+
+/**
+ * Whether the labels of an output object correspond to the simulated dates
+ */
+bool dailyLabels(SEXP labels, CharacterVector dates) {
+  if(TYPEOF(labels)!=STRSXP) return(false);
+  CharacterVector lab(labels);
+  int n = dates.size();
+  if((n==0) || (lab.size()!=n)) return(false);
+  return((lab[0]==dates[0]) && (lab[n-1]==dates[n-1]));
+}
+
+/**
+ * Truncates daily outputs (data frames and matrices with one row per date, vectors and lists
+ * named by dates) to the first 'simulatedDays' days. Other elements are returned unchanged.
+ */
+SEXP truncateDailyOutput(SEXP obj, CharacterVector dates, int simulatedDays) {
+  if(Rf_inherits(obj, "data.frame")) {
+    List df(obj);
+    if(!dailyLabels(df.attr("row.names"), dates)) return(obj);
+    List out(df.size());
+    for(int j=0;j<df.size();j++) {
+      SEXP col = df[j];
+      if(Rf_isMatrix(col) && (TYPEOF(col)==REALSXP)) out[j] = headRows(NumericMatrix(col), simulatedDays);
+      else out[j] = headElements(col, simulatedDays);
+    }
+    out.attr("names") = df.attr("names");
+    out.attr("row.names") = headElements(df.attr("row.names"), simulatedDays);
+    out.attr("class") = df.attr("class");
+    return(out);
+  }
+  if(Rf_isMatrix(obj) && (TYPEOF(obj)==REALSXP)) {
+    NumericMatrix m(obj);
+    if(!m.hasAttribute("dimnames")) return(obj);
+    List dn = m.attr("dimnames");
+    if(!dailyLabels(dn[0], dates)) return(obj);
+    return(headRows(m, simulatedDays));
+  }
+  if(TYPEOF(obj)==VECSXP) {
+    List l(obj);
+    if(dailyLabels(l.attr("names"), dates)) return(headElements(obj, simulatedDays));
+    List out = clone(l);
+    CharacterVector names = l.attr("names");
+    for(int j=0;j<l.size();j++) {
+      //Input objects are not daily outputs
+      if((names.size()==l.size()) && ((names[j]=="spwbInput") || (names[j]=="growthInput"))) continue;
+      out[j] = truncateDailyOutput(l[j], dates, simulatedDays);
+    }
+    return(out);
+  }
+  if(Rf_isVector(obj) && dailyLabels(Rf_getAttrib(obj, R_NamesSymbol), dates)) return(headElements(obj, simulatedDays));
+  return(obj);
+}
@@ -0,0 +1,19 @@
+#include <Rcpp.h>
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+#endif
+using namespace Rcpp;
+
+/*
+ * Scope of a simulation run. Cancellation requests made without a token during the run apply to it only.
+ */
+class SimulationRun {
+public:
+  SimulationRun();
+  ~SimulationRun();
+};
+bool simulationCancelRequested(List control);
+int progressInterval(List control);
+bool simulationCancelled(List control, int day, int numDays);
+SEXP truncateDailyOutput(SEXP obj, CharacterVector dates, int simulatedDays);
@@ -1,6 +1,7 @@
 #define STRICT_R_HEADERS
 #include <Rcpp.h>
 #include <numeric>
+#include <map>
 #include "hydraulics.h"
 using namespace Rcpp;
 using namespace std;
@@ -158,6 +159,50 @@ NumericMatrix rootDistribution(NumericVector z, List x) {
   return(rd);
 }
 
+/**
+ * Summary of a daily series used in the exploration of root distributions: mean, across 
+ * groups (years), of the minimum of the centered moving average (window of 'n' days) 
+ * within each group. As in stats::filter(sides = 2), the window of day i spans from 
+ * i - (n-1)/2 to i + n/2, and windows including missing values are discarded.
+ */
+// [[Rcpp::export(".movingAverageMinimumMean")]]
+double movingAverageMinimumMean(NumericVector x, IntegerVector group, int n = 10) {
+  if(x.size()!=group.size()) stop("Vectors 'x' and 'group' should have the same length.");
+  std::map<int, std::vector<double> > groupValues;
+  for(int i=0;i<x.size();i++) {
+    if(group[i]==NA_INTEGER) continue;
+    groupValues[group[i]].push_back(x[i]);
+  }
+  int o = n/2;
+  double sumMin = 0.0;
+  int ngroups = 0;
+  for(std::map<int, std::vector<double> >::iterator it = groupValues.begin(); it!=groupValues.end(); ++it) {
+    std::vector<double>& v = it->second;
+    int nv = v.size();
+    double minMA = NA_REAL;
+    for(int i=0;i<nv;i++) {
+      int lower = i + o - (n-1);
+      int upper = i + o;
+      if(lower<0 || upper>=nv) continue;
+      double s = 0.0;
+      bool valid = true;
+      for(int j=lower;j<=upper;j++) {
+        if(NumericVector::is_na(v[j])) {valid = false; break;}
+        s += v[j];
+      }
+      if(!valid) continue;
+      s = s/((double) n);
+      if(NumericVector::is_na(minMA) || s < minMA) minMA = s;
+    }
+    if(!NumericVector::is_na(minMA)) {
+      sumMin += minMA;
+      ngroups++;
+    }
+  }
+  if(ngroups==0) return(NA_REAL);
+  return(sumMin/((double) ngroups));
+}
+
 // DataFrame rootSpatialDimensions(double rootVolumeIndividual, NumericVector v, NumericVector d, NumericVector bulkDensity) {
 //   int numLayers = v.size();
 //   NumericVector lvol(numLayers,0.0);
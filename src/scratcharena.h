@@ -0,0 +1,44 @@
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <Rcpp.h>
+#include <vector>
+#include <algorithm>
+using namespace Rcpp;
+
+/**
+ * Scratch memory for the sub-daily temporaries of transpirationSperry(). An arena is created 
+ * by each simulation (spwb, pwb, growth) and passed down to the daily calls. The buffer is reset 
+ * at the start of each day and only grows when a larger size is needed, so that timestep, 
+ * cohort and canopy layer loops do not allocate R vectors. 
+ * 
+ * The arena holds the per-day soil and canopy layer vectors ('take') and a workspace, reused for 
+ * every cohort and time step, for the photosynthesis functions and profit maximization results. 
+ * Supply functions (built once per cohort and day) and the daily output matrices remain R objects.
+ */
+class ScratchArena {
+public:
+  ScratchArena() : used(0) {}
+  void reset(size_t capacity) {
+    if(buffer.size() < capacity) buffer.resize(capacity);
+    used = 0;
+  }
+  double* take(size_t n) {
+    if((used + n) > buffer.size()) stop("Scratch arena exhausted");
+    double* p = buffer.data() + used;
+    used += n;
+    std::fill(p, p + n, 0.0);
+    return(p);
+  }
+  //Buffer of at least 'n' values, valid until the next call (contents are not initialized)
+  double* workspace(size_t n) {
+    if(work.size() < n) work.resize(n);
+    return(work.data());
+  }
+private:
+  std::vector<double> buffer;
+  std::vector<double> work;
+  size_t used;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <Rcpp.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+using namespace Rcpp;
+
+/**
+ *  Sampling designs and indices for global sensitivity analysis. Designs are
+ *  generated in the unit hypercube (one column per parameter) and rescaled in R.
+ *  Model outputs are supplied as a matrix with one row per run and one column per
+ *  output summary.
+ */
+
+/**
+ * Random permutation of 0...n-1 (using R's random number generator)
+ */
+std::vector<int> randomPermutation(int n) {
+  std::vector<int> p(n);
+  for(int i=0;i<n;i++) p[i] = i;
+  for(int i=n-1;i>0;i--) {
+    int j = std::min((int) floor(R::runif(0.0, 1.0)*((double) (i+1))), i);
+    std::swap(p[i], p[j]);
+  }
+  return(p);
+}
+
+/**
+ * Latin hypercube sample of size n for k parameters
+ */
+// [[Rcpp::export(".sensitivityLHS")]]
+NumericMatrix sensitivityLHS(int n, int k) {
+  NumericMatrix X(n, k);
+  for(int j=0;j<k;j++) {
+    std::vector<int> p = randomPermutation(n);
+    for(int i=0;i<n;i++) X(i,j) = (((double) p[i]) + R::runif(0.0, 1.0))/((double) n);
+  }
+  return(X);
+}
+
+/**
+ * Morris (1991) design with r trajectories of k+1 points each, on a grid of p levels and
+ * with steps of size p/(2(p-1)). Each trajectory starts from a random grid point and
+ * changes one parameter at a time, in random order.
+ */
+// [[Rcpp::export(".sensitivityMorrisDesign")]]
+NumericMatrix sensitivityMorrisDesign(int r, int k, int levels = 4) {
+  if(levels < 2 || (levels % 2)!=0) stop("The number of levels should be an even number.");
+  double delta = ((double) levels)/(2.0*((double) (levels - 1)));
+  NumericMatrix X(r*(k+1), k);
+  std::vector<double> x(k);
+  for(int t=0;t<r;t++) {
+    int row = t*(k+1);
+    for(int j=0;j<k;j++) {
+      int l = std::min((int) floor(R::runif(0.0, 1.0)*((double) levels)), levels - 1);
+      x[j] = ((double) l)/((double) (levels - 1));
+      X(row, j) = x[j];
+    }
+    std::vector<int> order = randomPermutation(k);
+    for(int s=0;s<k;s++) {
+      int j = order[s];
+      if(x[j] + delta <= 1.0 + 1e-10) x[j] += delta;
+      else x[j] -= delta;
+      row++;
+      for(int jj=0;jj<k;jj++) X(row, jj) = x[jj];
+    }
+  }
+  return(X);
+}
+
+/**
+ * Morris elementary effects (in the unit scale): mean (mu), mean of absolute values (mu.star)
+ * and standard deviation (sigma) for each parameter (rows) and output (columns)
+ */
+// [[Rcpp::export(".sensitivityMorrisIndices")]]
+List sensitivityMorrisIndices(NumericMatrix X, NumericMatrix Y, int r) {
+  int k = X.ncol();
+  int nout = Y.ncol();
+  if(X.nrow()!=r*(k+1) || Y.nrow()!=X.nrow()) stop("Wrong dimensions of design or output matrices.");
+  NumericMatrix mu(k, nout), muStar(k, nout), sigma(k, nout);
+  for(int o=0;o<nout;o++) {
+    std::vector< std::vector<double> > ee(k);
+    for(int t=0;t<r;t++) {
+      for(int s=0;s<k;s++) {
+        int row = t*(k+1) + s;
+        int j = 0;
+        double dx = 0.0;
+        for(int jj=0;jj<k;jj++) {
+          double d = X(row+1, jj) - X(row, jj);
+          if(std::abs(d) > std::abs(dx)) {
+            dx = d;
+            j = jj;
+          }
+        }
+        double dy = Y(row+1, o) - Y(row, o);
+        if(dx!=0.0 && !NumericVector::is_na(dy)) ee[j].push_back(dy/dx);
+      }
+    }
+    for(int j=0;j<k;j++) {
+      int n = ee[j].size();
+      if(n==0) {
+        mu(j,o) = NA_REAL; muStar(j,o) = NA_REAL; sigma(j,o) = NA_REAL;
+        continue;
+      }
+      double s = 0.0, sa = 0.0;
+      for(int i=0;i<n;i++) {
+        s += ee[j][i];
+        sa += std::abs(ee[j][i]);
+      }
+      mu(j,o) = s/((double) n);
+      muStar(j,o) = sa/((double) n);
+      if(n>1) {
+        double ss = 0.0;
+        for(int i=0;i<n;i++) ss += pow(ee[j][i] - mu(j,o), 2.0);
+        sigma(j,o) = sqrt(ss/((double) (n-1)));
+      } else {
+        sigma(j,o) = NA_REAL;
+      }
+    }
+  }
+  return(List::create(_["mu"] = mu, _["mu.star"] = muStar, _["sigma"] = sigma));
+}
+
+/**
+ * First-order (Saltelli et al. 2010) and total (Jansen 1999) Sobol indices. Rows of Y
+ * correspond to matrices A (n runs), B (n runs) and AB_j (n runs for each parameter j,
+ * equal to A but with column j taken from B).
+ */
+// [[Rcpp::export(".sensitivitySobolIndices")]]
+List sensitivitySobolIndices(NumericMatrix Y, int n, int k) {
+  int nout = Y.ncol();
+  if(Y.nrow()!=n*(k+2)) stop("Wrong dimensions of output matrix.");
+  NumericMatrix S(k, nout), ST(k, nout);
+  for(int o=0;o<nout;o++) {
+    //Output variance from A and B runs
+    double sum = 0.0, sumsq = 0.0;
+    int m = 0;
+    for(int i=0;i<2*n;i++) {
+      double y = Y(i,o);
+      if(NumericVector::is_na(y)) continue;
+      sum += y;
+      sumsq += y*y;
+      m++;
+    }
+    double V = (m > 1 ? (sumsq - sum*sum/((double) m))/((double) (m-1)) : NA_REAL);
+    for(int j=0;j<k;j++) {
+      double sv = 0.0, svt = 0.0;
+      int nv = 0;
+      for(int i=0;i<n;i++) {
+        double yA = Y(i,o), yB = Y(n+i,o), yAB = Y((2+j)*n+i,o);
+        if(NumericVector::is_na(yA) || NumericVector::is_na(yB) || NumericVector::is_na(yAB)) continue;
+        sv += yB*(yAB - yA);
+        svt += pow(yA - yAB, 2.0);
+        nv++;
+      }
+      if(nv==0 || NumericVector::is_na(V) || V<=0.0) {
+        S(j,o) = NA_REAL;
+        ST(j,o) = NA_REAL;
+      } else {
+        S(j,o) = (sv/((double) nv))/V;
+        ST(j,o) = (0.5*svt/((double) nv))/V;
+      }
+    }
+  }
+  return(List::create(_["S"] = S, _["ST"] = ST));
+}
+
+/**
+ * Ranks (average ranks for ties) of a vector without missing values
+ */
+std::vector<double> averageRanks(const std::vector<double>& v) {
+  int n = v.size();
+  std::vector<int> idx(n);
+  for(int i=0;i<n;i++) idx[i] = i;
+  std::sort(idx.begin(), idx.end(), [&v](int a, int b) {return v[a] < v[b];});
+  std::vector<double> rk(n);
+  int i = 0;
+  while(i<n) {
+    int j = i;
+    while(j+1<n && v[idx[j+1]]==v[idx[i]]) j++;
+    double r = 0.5*((double) (i + j)) + 1.0;
+    for(int l=i;l<=j;l++) rk[idx[l]] = r;
+    i = j+1;
+  }
+  return(rk);
+}
+
+/**
+ * Spearman rank correlation between each parameter (rows) and output (columns),
+ * using the runs where the output is available
+ */
+// [[Rcpp::export(".sensitivityRankCorrelation")]]
+NumericMatrix sensitivityRankCorrelation(NumericMatrix X, NumericMatrix Y) {
+  int k = X.ncol();
+  int nout = Y.ncol();
+  int nr = X.nrow();
+  if(Y.nrow()!=nr) stop("Wrong dimensions of design or output matrices.");
+  NumericMatrix R(k, nout);
+  for(int o=0;o<nout;o++) {
+    std::vector<double> y;
+    std::vector<int> rows;
+    for(int i=0;i<nr;i++) {
+      if(NumericVector::is_na(Y(i,o))) continue;
+      y.push_back(Y(i,o));
+      rows.push_back(i);
+    }
+    int n = y.size();
+    std::vector<double> ry = averageRanks(y);
+    for(int j=0;j<k;j++) {
+      if(n<3) {
+        R(j,o) = NA_REAL;
+        continue;
+      }
+      std::vector<double> x(n);
+      for(int i=0;i<n;i++) x[i] = X(rows[i], j);
+      std::vector<double> rx = averageRanks(x);
+      double mx = 0.0, my = 0.0;
+      for(int i=0;i<n;i++) {mx += rx[i]; my += ry[i];}
+      mx = mx/((double) n);
+      my = my/((double) n);
+      double sxy = 0.0, sxx = 0.0, syy = 0.0;
+      for(int i=0;i<n;i++) {
+        sxy += (rx[i]-mx)*(ry[i]-my);
+        sxx += (rx[i]-mx)*(rx[i]-mx);
+        syy += (ry[i]-my)*(ry[i]-my);
+      }
+      R(j,o) = ((sxx > 0.0 && syy > 0.0) ? sxy/sqrt(sxx*syy) : NA_REAL);
+    }
+  }
+  return(R);
+}
@@ -13,6 +13,10 @@
 #include "phenology.h"
 #include "transpiration.h"
 #include "soil.h"
+#include "meteoforcing.h"
+#include "progress.h"
+#include "diagnostics.h"
+#include "aggregation.h"
 #include <meteoland.h>
 using namespace Rcpp;
 
@@ -169,7 +173,8 @@ List spwbDay1(List x, NumericVector meteovec,
 List spwbDay2(List x, NumericVector meteovec, 
              double latitude, double elevation, double slope, double aspect,
              double solarConstant, double delta, 
-             double runon=0.0, bool verbose = false) {
+             double runon=0.0, bool verbose = false, List subdailyForcing = List(), 
+             ScratchArena* arena = NULL) {
   
   //Control parameters
   List control = x["control"];
@@ -234,6 +239,7 @@ List spwbDay2(List x, NumericVector meteovec,
   double LgroundPAR = exp((-1.0)*s);
   double LgroundSWR = exp((-1.0)*s/1.35);
   
+  double diagSoil = diagnosticsStart();
   //A.1 - Snow pack dynamics and soil water input
   NumericVector hydroInputs = soilWaterInputs(soil, soilFunctions, prec, er, tday, rad, elevation,
                                               Cm, LgroundPAR, LgroundSWR, 
@@ -286,13 +292,14 @@ List spwbDay2(List x, NumericVector meteovec,
       }
     }
   }
+  diagnosticsStop(DIAGNOSTICS_SOIL_FLOWS, diagSoil);
 
   //B.2 - Canopy transpiration  
   List transp = transpirationSperry(x, meteovec, 
                                     latitude, elevation, slope, aspect, 
                                     solarConstant, delta, 
                                     hydroInputs["Interception"], hydroInputs["Snowmelt"], sum(EsoilVec),
-                                    verbose, NA_INTEGER, true);
+                                    verbose, NA_INTEGER, true, subdailyForcing, arena);
 
   
   NumericMatrix soilLayerExtractInst = Rcpp::as<Rcpp::NumericMatrix>(transp["ExtractionInst"]);
@@ -630,18 +637,24 @@ List defineSunlitShadeLeavesDailyOutput(DataFrame meteo, DataFrame above) {
   NumericMatrix LeafGSWMax(numDays, numCohorts);
   NumericMatrix TempMin(numDays, numCohorts);
   NumericMatrix TempMax(numDays, numCohorts);
+  NumericMatrix LeafiWUE(numDays, numCohorts);
+  NumericMatrix LeafCi(numDays, numCohorts);
   LeafPsiMin.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   LeafPsiMax.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   LeafGSWMin.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   LeafGSWMax.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   TempMin.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   TempMax.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
+  LeafiWUE.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
+  LeafCi.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
   List shade = List::create(Named("LeafPsiMin") = LeafPsiMin, 
                             Named("LeafPsiMax") = LeafPsiMax,
                             Named("TempMin") = TempMin, 
                             Named("TempMax") = TempMax,
                             Named("GSWMin") = LeafGSWMin,
-                            Named("GSWMax") = LeafGSWMax);
+                            Named("GSWMax") = LeafGSWMax,
+                            Named("iWUE") = LeafiWUE,
+                            Named("Ci") = LeafCi);
   return(shade);
 }
 
@@ -706,6 +719,7 @@ List definePlantWaterDailyOutput(DataFrame meteo, DataFrame above, List soil, Li
     NumericMatrix PlantGrossPhotosynthesis(numDays, numCohorts);
     NumericMatrix PlantAbsSWR(numDays, numCohorts);
     NumericMatrix PlantNetLWR(numDays, numCohorts);
+    NumericMatrix LeafiWUE(numDays, numCohorts), LeafCi(numDays, numCohorts);
     StemRWC.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
     LeafRWC.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
     StemSympRWC.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
@@ -720,6 +734,8 @@ List definePlantWaterDailyOutput(DataFrame meteo, DataFrame above, List soil, Li
     PlantNetPhotosynthesis.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
     PlantAbsSWR.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
     PlantNetLWR.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
+    LeafiWUE.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
+    LeafCi.attr("dimnames") = List::create(meteo.attr("row.names"), above.attr("row.names")) ;
     
     plants = List::create(Named("LAI") = PlantLAI,
                           Named("LAIlive") = PlantLAIlive,
@@ -732,6 +748,8 @@ List definePlantWaterDailyOutput(DataFrame meteo, DataFrame above, List soil, Li
                                Named("PlantWaterBalance") = PlantWaterBalance,
                                Named("LeafPsiMin") = LeafPsiMin, 
                                Named("LeafPsiMax") = LeafPsiMax, 
+                               Named("LeafiWUE") = LeafiWUE, 
+                               Named("LeafCi") = LeafCi, 
                                Named("LeafRWC") = LeafRWC, 
                                Named("StemRWC") = StemRWC, 
                                Named("LeafSympRWC") = LeafSympRWC, 
@@ -930,6 +948,12 @@ void fillPlantWaterDailyOutput(List x, List sunlit, List shade, List sDay, int i
     NumericMatrix LeafGSWMax_SH = Rcpp::as<Rcpp::NumericMatrix>(shade["GSWMax"]);
     NumericMatrix LeafTempMin_SH = Rcpp::as<Rcpp::NumericMatrix>(shade["TempMin"]);
     NumericMatrix LeafTempMax_SH = Rcpp::as<Rcpp::NumericMatrix>(shade["TempMax"]);    
+    NumericMatrix LeafiWUE_SL = Rcpp::as<Rcpp::NumericMatrix>(sunlit["iWUE"]);
+    NumericMatrix LeafiWUE_SH = Rcpp::as<Rcpp::NumericMatrix>(shade["iWUE"]);
+    NumericMatrix LeafCi_SL = Rcpp::as<Rcpp::NumericMatrix>(sunlit["Ci"]);
+    NumericMatrix LeafCi_SH = Rcpp::as<Rcpp::NumericMatrix>(shade["Ci"]);
+    NumericMatrix LeafiWUE = Rcpp::as<Rcpp::NumericMatrix>(x["LeafiWUE"]);
+    NumericMatrix LeafCi = Rcpp::as<Rcpp::NumericMatrix>(x["LeafCi"]);
     List RhizoPsi = x["RhizoPsi"];
     NumericMatrix PlantNetPhotosynthesis= Rcpp::as<Rcpp::NumericMatrix>(x["NetPhotosynthesis"]);
     NumericMatrix PlantGrossPhotosynthesis= Rcpp::as<Rcpp::NumericMatrix>(x["GrossPhotosynthesis"]);
@@ -972,6 +996,12 @@ void fillPlantWaterDailyOutput(List x, List sunlit, List shade, List sDay, int i
     LeafTempMax_SL(iday,_) = Rcpp::as<Rcpp::NumericVector>(SunlitLeaves["TempMax"]);
     LeafTempMin_SH(iday,_) = Rcpp::as<Rcpp::NumericVector>(ShadeLeaves["TempMin"]);
     LeafTempMax_SH(iday,_) = Rcpp::as<Rcpp::NumericVector>(ShadeLeaves["TempMax"]);
+    LeafiWUE_SL(iday,_) = Rcpp::as<Rcpp::NumericVector>(SunlitLeaves["iWUE"]);
+    LeafiWUE_SH(iday,_) = Rcpp::as<Rcpp::NumericVector>(ShadeLeaves["iWUE"]);
+    LeafCi_SL(iday,_) = Rcpp::as<Rcpp::NumericVector>(SunlitLeaves["Ci"]);
+    LeafCi_SH(iday,_) = Rcpp::as<Rcpp::NumericVector>(ShadeLeaves["Ci"]);
+    LeafiWUE(iday,_) = Rcpp::as<Rcpp::NumericVector>(Plants["LeafiWUE"]);
+    LeafCi(iday,_) = Rcpp::as<Rcpp::NumericVector>(Plants["LeafCi"]);
     
     PlantNetPhotosynthesis(iday,_) = Rcpp::as<Rcpp::NumericVector>(Plants["NetPhotosynthesis"]);
     PlantGrossPhotosynthesis(iday,_) = Rcpp::as<Rcpp::NumericVector>(Plants["GrossPhotosynthesis"]);
@@ -1151,6 +1181,27 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
   }
   CharacterVector dateStrings = meteo.attr("row.names");
   
+  //Precomputed daily and subdaily forcing (see meteoForcing)
+  bool forcing_input = isCompatibleMeteoForcing(meteo, latitude, elevation, slope, aspect, 
+                                                Rcpp::as<int>(control["ndailysteps"]), transpirationMode=="Sperry");
+  List subdailyForcing;
+  NumericVector PETForcing, SolarDeclination, SolarConstant;
+  if(forcing_input) {
+    List forcing = meteo.attr("forcing");
+    subdailyForcing = meteo.attr("subdaily");
+    DOY = forcing["DOY"];
+    Photoperiod = forcing["Photoperiod"];
+    JulianDay = forcing["JulianDay"];
+    PETForcing = forcing["PET"];
+    SolarDeclination = forcing["SolarDeclination"];
+    SolarConstant = forcing["SolarConstant"];
+    doy_input = true;
+    photoperiod_input = true;
+    julianday_input = true;
+    if(verbose) {
+      Rcout<<"Daily and subdaily forcing taken from 'meteoForcing' object\n";
+    }
+  }
   if(!doy_input) DOY = date2doy(dateStrings);
   if(!photoperiod_input) Photoperiod = date2photoperiod(dateStrings, latrad);
   
@@ -1164,27 +1215,50 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
   //Detailed subday results
   List subdailyRes(numDays);
   
+  //In-run temporal aggregation (daily outputs are then kept in two-row buffers)
+  TemporalAggregator aggregator(control, dateStrings, Rcpp::as<Rcpp::DataFrame>(x["cohorts"]));
+  int numRows = aggregator.outputRows(numDays);
+  DataFrame outputFrame = aggregator.outputFrame(meteo);
+  
+  //In-run drought stress indices
+  DroughtStressAccumulator stressIndices(control, dateStrings, Rcpp::as<Rcpp::DataFrame>(x["cohorts"]));
+  
   //Stand output variables
-  NumericVector LAI(numDays),LAIexpanded(numDays),LAIlive(numDays),LAIdead(numDays);
-  NumericVector Cm(numDays);
-  NumericVector LgroundPAR(numDays);
-  NumericVector LgroundSWR(numDays);
+  NumericVector LAI(numRows),LAIexpanded(numRows),LAIlive(numRows),LAIdead(numRows);
+  NumericVector Cm(numRows);
+  NumericVector LgroundPAR(numRows);
+  NumericVector LgroundSWR(numRows);
   
   
   //Water balance output variables
-  DataFrame DWB = defineWaterBalanceDailyOutput(meteo, PET, transpirationMode);
-  DataFrame SWB = defineSoilWaterBalanceDailyOutput(meteo, soil, transpirationMode);
+  DataFrame DWB = defineWaterBalanceDailyOutput(outputFrame, (aggregator.active ? NumericVector(numRows, NA_REAL) : PET), transpirationMode);
+  DataFrame SWB = defineSoilWaterBalanceDailyOutput(outputFrame, soil, transpirationMode);
   
   //EnergyBalance output variables
-  DataFrame DEB = defineEnergyBalanceDailyOutput(meteo);
-  DataFrame DT = defineTemperatureDailyOutput(meteo);
+  DataFrame DEB = defineEnergyBalanceDailyOutput(outputFrame);
+  DataFrame DT = defineTemperatureDailyOutput(outputFrame);
   NumericMatrix DLT;
-  if(transpirationMode=="Sperry") DLT =  defineTemperatureLayersDailyOutput(meteo, canopy);
+  if(transpirationMode=="Sperry") DLT =  defineTemperatureLayersDailyOutput(outputFrame, canopy);
   
   //Plant output variables
-  List sunlitDO = defineSunlitShadeLeavesDailyOutput(meteo, above);
-  List shadeDO = defineSunlitShadeLeavesDailyOutput(meteo, above);
-  List plantDWOL = definePlantWaterDailyOutput(meteo, above, soil, control);
+  List sunlitDO = defineSunlitShadeLeavesDailyOutput(outputFrame, above);
+  List shadeDO = defineSunlitShadeLeavesDailyOutput(outputFrame, above);
+  List plantDWOL = definePlantWaterDailyOutput(outputFrame, above, soil, control);
+  
+  List standDO = List::create(_["LAI"]=LAI, _["LAIlive"]=LAIlive, _["LAIexpanded"] = LAIexpanded, _["LAIdead"] = LAIdead,  
+                              _["Cm"]=Cm, 
+                              _["LgroundPAR"] = LgroundPAR, _["LgroundSWR"] = LgroundSWR);
+  if(aggregator.active) {
+    List buffer = List::create(_["WaterBalance"] = DWB, _["Soil"] = SWB, _["Stand"] = standDO, _["Plants"] = plantDWOL);
+    if(transpirationMode=="Sperry") {
+      buffer.push_back(DEB, "EnergyBalance");
+      buffer.push_back(DT, "Temperature");
+      if(multiLayerBalance) buffer.push_back(DLT, "TemperatureLayers");
+      buffer.push_back(sunlitDO, "SunlitLeaves");
+      buffer.push_back(shadeDO, "ShadeLeaves");
+    }
+    aggregator.setBuffer(buffer);
+  }
 
   
   NumericVector initialContent = water(soil, soilFunctions);
@@ -1194,11 +1268,23 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
     Rcout<<"Initial snowpack content (mm): "<< initialSnowContent<<"\n";
   }
   
+  resetDiagnostics(diagnosticsRequested(control));
+  SimulationRun simulationRun;
+  ScratchArena arena;
+  int progressDays = progressInterval(control);
+  int simulatedDays = numDays;
   bool error_occurence = false;
   if(verbose) Rcout << "Performing daily simulations\n";
   NumericVector Eplanttot(numDays,0.0);
   List s;
   for(int i=0;(i<numDays) & (!error_occurence);i++) {
+      if((progressDays > 0) && (i > 0) && ((i % progressDays)==0)) {
+        if(simulationCancelled(control, i, numDays)) {
+          simulatedDays = i;
+          break;
+        }
+      }
+      int iRow = (aggregator.active ? 0 : i);
       if(verbose) {
         if(DOY[i]==1 || i==0) {
           std::string c = as<std::string>(dateStrings[i]);
@@ -1256,8 +1342,14 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
           std::string c = as<std::string>(dateStrings[i]);
           J = meteoland::radiation_julianDay(std::atoi(c.substr(0, 4).c_str()),std::atoi(c.substr(5,2).c_str()),std::atoi(c.substr(8,2).c_str())); 
         }
-        double delta = meteoland::radiation_solarDeclination(J);
-        double solarConstant = meteoland::radiation_solarConstant(J);
+        double delta, solarConstant;
+        if(forcing_input) {
+          delta = SolarDeclination[i];
+          solarConstant = SolarConstant[i];
+        } else {
+          delta = meteoland::radiation_solarDeclination(J);
+          solarConstant = meteoland::radiation_solarConstant(J);
+        }
         if(NumericVector::is_na(aspect)) aspect = 0.0;
         if(NumericVector::is_na(slope)) slope = 0.0;
         double asprad = aspect * (M_PI/180.0);
@@ -1277,7 +1369,8 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
         double rad = Radiation[i];
         double Catm = CO2[i];
         if(NumericVector::is_na(Catm)) Catm = control["Catm"];
-        PET[i] = meteoland::penman(latrad, elevation, slorad, asprad, J, tmin, tmax, rhmin, rhmax, rad, wind);
+        if(forcing_input) PET[i] = PETForcing[i];
+        else PET[i] = meteoland::penman(latrad, elevation, slorad, asprad, J, tmin, tmax, rhmin, rhmax, rad, wind);
         NumericVector meteovec = NumericVector::create(
           Named("tmin") = tmin, 
           Named("tmax") = tmax,
@@ -1292,34 +1385,42 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
           Named("Catm") = Catm,
           Named("pet") = PET[i],
           Named("er") = erFactor(DOY[i], PET[i], Precipitation[i]));
+          List sdForcing;
+          if(forcing_input) sdForcing = meteoForcingDay(subdailyForcing, i);
           try{
             s = spwbDay2(x, meteovec, 
                          latitude, elevation, slope, aspect,
                          solarConstant, delta, 
-                         0.0, verbose); 
+                         0.0, verbose, sdForcing, &arena); 
           } catch(std::exception& ex) {
             Rcerr<< "c++ error: "<< ex.what() <<"\n";
             error_occurence = true;
           }
         
-        fillEnergyBalanceTemperatureDailyOutput(DEB,DT,DLT, s,i, multiLayerBalance);
+        fillEnergyBalanceTemperatureDailyOutput(DEB,DT,DLT, s,iRow, multiLayerBalance);
       }
       
       //Update plant daily water output
-      fillPlantWaterDailyOutput(plantDWOL, sunlitDO, shadeDO, s, i, transpirationMode);
-      fillWaterBalanceDailyOutput(DWB, s,i, transpirationMode);
+      fillPlantWaterDailyOutput(plantDWOL, sunlitDO, shadeDO, s, iRow, transpirationMode);
+      fillWaterBalanceDailyOutput(DWB, s,iRow, transpirationMode);
       fillSoilWaterBalanceDailyOutput(SWB, soil, s,
-                                      i, numDays, transpirationMode, soilFunctions);
+                                      iRow, numRows, transpirationMode, soilFunctions);
       
       List stand = s["Stand"];
-      LgroundPAR[i] = stand["LgroundPAR"];
-      LgroundSWR[i] = stand["LgroundSWR"];
-      LAI[i] = stand["LAI"];
-      LAIexpanded[i] = stand["LAIexpanded"];
-      LAIlive[i] = stand["LAIlive"];
-      LAIdead[i] = stand["LAIdead"];
-      Cm[i] = stand["Cm"];
+      LgroundPAR[iRow] = stand["LgroundPAR"];
+      LgroundSWR[iRow] = stand["LgroundSWR"];
+      LAI[iRow] = stand["LAI"];
+      LAIexpanded[iRow] = stand["LAIexpanded"];
+      LAIlive[iRow] = stand["LAIlive"];
+      LAIdead[iRow] = stand["LAIdead"];
+      Cm[iRow] = stand["Cm"];
       
+      if(stressIndices.active) stressIndices.addDay(i, s["Plants"], transpirationMode);
+      if(aggregator.active) {
+        NumericVector PETrow = as<Rcpp::NumericVector>(DWB["PET"]);
+        PETrow[iRow] = PET[i];
+        aggregator.addDay(i);
+      }
 
       if(subdailyResults) {
         subdailyRes[i] = clone(s);
@@ -1328,12 +1429,15 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
   if(verbose) Rcout << "\n\n";
   
   if(verbose) {
-    printWaterBalanceResult(DWB, plantDWOL, soil, soilFunctions,
+    if(!aggregator.active) printWaterBalanceResult(DWB, plantDWOL, soil, soilFunctions,
                             initialContent, initialSnowContent,
                             transpirationMode);
     if(error_occurence) {
       Rcout<< " ERROR: Calculations stopped because of numerical error: Revise parameters\n";
     }
+    if(simulatedDays < numDays) {
+      Rcout<< " Simulation cancelled after "<< simulatedDays << " days\n";
+    }
   }
 
 
@@ -1342,10 +1446,8 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
   NumericVector topo = NumericVector::create(elevation, slope, aspect);
   topo.attr("names") = CharacterVector::create("elevation", "slope", "aspect");
   
-  DataFrame Stand = DataFrame::create(_["LAI"]=LAI, _["LAIlive"]=LAIlive, _["LAIexpanded"] = LAIexpanded, _["LAIdead"] = LAIdead,  
-                                      _["Cm"]=Cm, 
-                                      _["LgroundPAR"] = LgroundPAR, _["LgroundSWR"] = LgroundSWR);
-  Stand.attr("row.names") = meteo.attr("row.names");
+  DataFrame Stand = DataFrame(standDO);
+  Stand.attr("row.names") = outputFrame.attr("row.names");
   
   List l;
   if(transpirationMode=="Granier") {
@@ -1373,7 +1475,26 @@ List spwb(List x, DataFrame meteo, double latitude, double elevation = NA_REAL,
                      Named("subdaily") =  subdailyRes);
     if(multiLayerBalance) l["TemperatureLayers"] = DLT;
   }
+  if(aggregator.active) {
+    List agg = aggregator.result();
+    CharacterVector aggNames = agg.attr("names");
+    for(int j=0;j<agg.size();j++) {
+      std::string name = as<std::string>(aggNames[j]);
+      l[name] = agg[j];
+    }
+    l.attr("aggregated") = true;
+  }
+  if(stressIndices.active) l.push_back(stressIndices.result(), "DroughtStress");
+  if(diagnosticsEnabled) {
+    l.push_back(diagnosticsList(), "Diagnostics");
+    resetDiagnostics(false);
+  }
   l.attr("class") = CharacterVector::create("spwb","list");
+  if(simulatedDays < numDays) {
+    l = truncateDailyOutput(l, meteo.attr("row.names"), simulatedDays);
+    l.attr("simulatedDays") = simulatedDays;
+    warning("Simulation cancelled: results are partial (only the first " + std::to_string(simulatedDays) + " days were simulated).");
+  }
   return(l);
 }
 
@@ -1480,6 +1601,27 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
   }
   CharacterVector dateStrings = meteo.attr("row.names");
   
+  //Precomputed daily and subdaily forcing (see meteoForcing)
+  bool forcing_input = isCompatibleMeteoForcing(meteo, latitude, elevation, slope, aspect, 
+                                                Rcpp::as<int>(control["ndailysteps"]), transpirationMode=="Sperry");
+  List subdailyForcing;
+  NumericVector PETForcing, SolarDeclination, SolarConstant;
+  if(forcing_input) {
+    List forcing = meteo.attr("forcing");
+    subdailyForcing = meteo.attr("subdaily");
+    DOY = forcing["DOY"];
+    Photoperiod = forcing["Photoperiod"];
+    JulianDay = forcing["JulianDay"];
+    PETForcing = forcing["PET"];
+    SolarDeclination = forcing["SolarDeclination"];
+    SolarConstant = forcing["SolarConstant"];
+    doy_input = true;
+    photoperiod_input = true;
+    julianday_input = true;
+    if(verbose) {
+      Rcout<<"Daily and subdaily forcing taken from 'meteoForcing' object\n";
+    }
+  }
   if(!doy_input) DOY = date2doy(dateStrings);
   if(!photoperiod_input) Photoperiod = date2photoperiod(dateStrings, latrad);
   
@@ -1527,11 +1669,21 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
   NumericVector EplantCohTot(numCohorts, 0.0);
 
   
+  SimulationRun simulationRun;
+  ScratchArena arena;
+  int progressDays = progressInterval(control);
+  int simulatedDays = numDays;
   bool error_occurence = false;
   if(verbose) Rcout << "Performing daily simulations ";
   NumericVector Eplanttot(numDays,0.0);
   List s;
   for(int i=0;i<numDays;i++) {
+    if((progressDays > 0) && (i > 0) && ((i % progressDays)==0)) {
+      if(simulationCancelled(control, i, numDays)) {
+        simulatedDays = i;
+        break;
+      }
+    }
     if(verbose) {
       if(DOY[i]==1 || i==0) {
         std::string c = as<std::string>(dateStrings[i]);
@@ -1593,8 +1745,14 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
         J = meteoland::radiation_julianDay(std::atoi(c.substr(0, 4).c_str()),std::atoi(c.substr(5,2).c_str()),std::atoi(c.substr(8,2).c_str())); 
       }
       
-      double delta = meteoland::radiation_solarDeclination(J);
-      double solarConstant = meteoland::radiation_solarConstant(J);
+      double delta, solarConstant;
+      if(forcing_input) {
+        delta = SolarDeclination[i];
+        solarConstant = SolarConstant[i];
+      } else {
+        delta = meteoland::radiation_solarDeclination(J);
+        solarConstant = meteoland::radiation_solarConstant(J);
+      }
       double tmin = MinTemperature[i];
       double tmax = MaxTemperature[i];
       double tmaxPrev = tmax;
@@ -1622,13 +1780,15 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
         Named("rad") = rad, 
         Named("wind") = wind, 
         Named("Catm") = Catm);
+      List sdForcing;
+      if(forcing_input) sdForcing = meteoForcingDay(subdailyForcing, i);
       try{
         s = transpirationSperry(x, meteovec, 
                                 latitude, elevation, slope, aspect,
                                 solarConstant, delta,
                                 canopyEvaporation[i], snowMelt[i], soilEvaporation[i],
                                 verbose, NA_INTEGER, 
-                                true);
+                                true, sdForcing, &arena);
       } catch(std::exception& ex) {
         Rcerr<< "c++ error: "<< ex.what() <<"\n";
         error_occurence = true;
@@ -1688,6 +1848,9 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
     if(error_occurence) {
       Rcout<< " ERROR: Calculations stopped because of numerical error: Revise parameters\n";
     }
+    if(simulatedDays < numDays) {
+      Rcout<< " Simulation cancelled after "<< simulatedDays << " days\n";
+    }
   }
 
   
@@ -1744,5 +1907,10 @@ List pwb(List x, DataFrame meteo, NumericMatrix W,
     if(multiLayerBalance) l["TemperatureLayers"] = DLT;
   }
   l.attr("class") = CharacterVector::create("pwb","list");
+  if(simulatedDays < numDays) {
+    l = truncateDailyOutput(l, meteo.attr("row.names"), simulatedDays);
+    l.attr("simulatedDays") = simulatedDays;
+    warning("Simulation cancelled: results are partial (only the first " + std::to_string(simulatedDays) + " days were simulated).");
+  }
   return(l);                    
 }
\ No newline at end of file
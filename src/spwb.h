@@ -3,6 +3,7 @@
 #ifndef SPWB_H
 #define SPWB_H
 #endif
+#include "scratcharena.h"
 using namespace Rcpp;
 
 void checkspwbInput(List x, String transpirationMode);
@@ -38,4 +39,5 @@ List spwbDay1(List x, NumericVector meteovec,
 List spwbDay2(List x, NumericVector meteovec, 
               double latitude, double elevation, double slope, double aspect,
               double solarConstant, double delta, 
-              double runon=0.0, bool verbose = false);
\ No newline at end of file
+              double runon=0.0, bool verbose = false, List subdailyForcing = List(), 
+              ScratchArena* arena = NULL);
\ No newline at end of file
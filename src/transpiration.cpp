@@ -13,6 +13,8 @@
 #include "photosynthesis.h"
 #include "root.h"
 #include "soil.h"
+#include "diagnostics.h"
+#include "scratcharena.h"
 #include <meteoland.h>
 using namespace Rcpp;
 
@@ -58,17 +60,14 @@ void rhizosphereMoistureExtraction(NumericMatrix cohExtract,
 }
 
 
-// [[Rcpp::export("transp_profitMaximization")]]
-List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, double Gswmin, double Gswmax, 
-                        double gainModifier = 1.0, double costModifier = 1.0, String costWater = "dEdP") {
-  NumericVector supplyE = supplyFunction["E"];
-  NumericVector supplydEdp = supplyFunction["dEdP"];
-  NumericVector Ag = photosynthesisFunction["GrossPhotosynthesis"];
-  NumericVector leafTemp = photosynthesisFunction["LeafTemperature"];
-  NumericVector leafVPD = photosynthesisFunction["LeafVPD"];
-  NumericVector Gsw = photosynthesisFunction["Gsw"];
-  NumericVector supplyKterm = supplyFunction["kterm"];
-  int nsteps = supplydEdp.size();
+/**
+ * Native version of profitMaximization(). Cost, gain and profit of each step of the supply function are written 
+ * into the supplied buffers (of length 'nsteps') and the index of maximum profit is returned.
+ */
+int profitMaximizationNative(const double* supplyE, const double* supplydEdp, const double* supplyKterm, int nsteps,
+                             const double* Ag, const double* Gsw, const double* leafTemp, const double* leafVPD,
+                             double Gswmin, double Gswmax, double gainModifier, double costModifier, bool dEdPCost,
+                             double* cost, double* gain, double* profit) {
   double maxdEdp = 0.0, mindEdp = 99999999.0;
   double maxKterm = 0.0, minKterm = 99999999.0;
   double Agmax = 0.0;
@@ -83,7 +82,7 @@ List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, d
     //   maxdEdp = supplydEdp[i];
     //   imaxdEdp = i;
     // }
-    if(costWater=="dEdP") {
+    if(dEdPCost) {
       mindEdp = std::min(mindEdp, supplydEdp[i]);
       maxdEdp = std::max(maxdEdp, supplydEdp[i]);
     } else {
@@ -94,12 +93,12 @@ List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, d
   }
   
   //Evaluate profit for valid steps
-  NumericVector profit(nsteps, NA_REAL);
-  NumericVector cost(nsteps, NA_REAL);
-  NumericVector gain(nsteps, NA_REAL);
+  std::fill(profit, profit + nsteps, NA_REAL);
+  std::fill(cost, cost + nsteps, NA_REAL);
+  std::fill(gain, gain + nsteps, NA_REAL);
   for(int i=ini;i<fin;i++) {
     gain[i] = pow(Ag[i]/Agmax, gainModifier);
-    if(costWater=="dEdP") {
+    if(dEdPCost) {
       cost[i] = pow((maxdEdp-supplydEdp[i])/(maxdEdp-mindEdp), costModifier); 
     }  else {
       cost[i] = pow((maxKterm-supplyKterm[i])/(maxKterm-minKterm), costModifier);
@@ -127,24 +126,67 @@ List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, d
   // Rcout<<ini<< " "<< fin<< " Gsw= " << Gsw[imaxprofit] <<" Gswmax= "<<Gswmax<<" Gswmin "<<Gswmin<<" iPM="<< imaxprofit<<" Eini=" <<supplyE[ini]<<" Efin=" <<supplyE[fin]<<" E[iPM]=" <<supplyE[imaxprofit]<<"\n";
   if((Gsw[imaxprofit] > Gswmax) && (imaxprofit>ini)) {
     Rcout<<ini<< " "<< fin<< " Gsw= " << Gsw[imaxprofit] <<" Gswmax= "<<Gswmax<<" Gswmin "<<Gswmin<<" iPM="<< imaxprofit<<" Eini=" <<supplyE[ini]<<" Efin=" <<supplyE[fin]<<" E[iPM]=" <<supplyE[imaxprofit]<<"\n";
-    for(int i=0;i<Gsw.size();i++) {
+    for(int i=0;i<nsteps;i++) {
       Rcout<< i << " Gsw "<< Gsw[i] << " supplyE "<< supplyE[i] << " leafT "<< leafTemp[i]<< " leafVPD "<< leafVPD[i]  << "\n";
     }
     stop("Gsw > Gswmax");
   }
+  return(imaxprofit);
+}
+
+// [[Rcpp::export("transp_profitMaximization")]]
+List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, double Gswmin, double Gswmax, 
+                        double gainModifier = 1.0, double costModifier = 1.0, String costWater = "dEdP") {
+  bool dEdPCost = (costWater=="dEdP");
+  NumericVector supplyE = supplyFunction["E"];
+  NumericVector supplydEdp = supplyFunction["dEdP"];
+  NumericVector Ag = photosynthesisFunction["GrossPhotosynthesis"];
+  NumericVector leafTemp = photosynthesisFunction["LeafTemperature"];
+  NumericVector leafVPD = photosynthesisFunction["LeafVPD"];
+  NumericVector Gsw = photosynthesisFunction["Gsw"];
+  NumericVector supplyKterm = supplyFunction["kterm"];
+  int nsteps = supplydEdp.size();
+  NumericVector profit(nsteps, NA_REAL);
+  NumericVector cost(nsteps, NA_REAL);
+  NumericVector gain(nsteps, NA_REAL);
+  int imaxprofit = profitMaximizationNative(supplyE.begin(), supplydEdp.begin(), supplyKterm.begin(), nsteps,
+                                            Ag.begin(), Gsw.begin(), leafTemp.begin(), leafVPD.begin(),
+                                            Gswmin, Gswmax, gainModifier, costModifier, dEdPCost,
+                                            cost.begin(), gain.begin(), profit.begin());
   return(List::create(Named("Cost") = cost,
                       Named("Gain") = gain,
                       Named("Profit") = profit,
                       Named("iMaxProfit")=imaxprofit));
 }
 
+/**
+ * R representations of the photosynthesis function (six consecutive buffers of length 'nsteps', see 
+ * leafPhotosynthesisFunction2Native) and profit maximization results (cost, gain and profit buffers), 
+ * created only when transpirationSperry() is asked to return them.
+ */
+DataFrame photosynthesisFunctionDataFrame(const double* photo, int nsteps) {
+  return(DataFrame::create(Named("LeafTemperature") = NumericVector(photo, photo + nsteps),
+                           Named("LeafVPD") = NumericVector(photo + nsteps, photo + 2*nsteps),
+                           Named("Gsw") = NumericVector(photo + 2*nsteps, photo + 3*nsteps),
+                           Named("Ci") = NumericVector(photo + 3*nsteps, photo + 4*nsteps),
+                           Named("GrossPhotosynthesis") = NumericVector(photo + 4*nsteps, photo + 5*nsteps),
+                           Named("NetPhotosynthesis") = NumericVector(photo + 5*nsteps, photo + 6*nsteps)));
+}
+List profitMaximizationList(const double* pm, int nsteps, int imaxprofit) {
+  return(List::create(Named("Cost") = NumericVector(pm, pm + nsteps),
+                      Named("Gain") = NumericVector(pm + nsteps, pm + 2*nsteps),
+                      Named("Profit") = NumericVector(pm + 2*nsteps, pm + 3*nsteps),
+                      Named("iMaxProfit")=imaxprofit));
+}
+
 
 List transpirationSperry(List x, NumericVector meteovec, 
                   double latitude, double elevation, double slope, double aspect, 
                   double solarConstant, double delta,
                   double canopyEvaporation = 0.0, double snowMelt = 0.0, double soilEvaporation = 0.0,
                   bool verbose = false, int stepFunctions = NA_INTEGER, 
-                  bool modifyInput = true) {
+                  bool modifyInput = true, List subdailyForcing = List(), 
+                  ScratchArena* arena = NULL) {
   //Control parameters
   List control = x["control"];
   String soilFunctions = control["soilFunctions"];
@@ -156,12 +198,15 @@ List transpirationSperry(List x, NumericVector meteovec,
   bool capacitance = control["capacitance"];
   bool cochard = control["cochard"];
   String cavitationRefill = control["cavitationRefill"];
+  bool totalRefill = (cavitationRefill=="total");
+  bool rateRefill = (cavitationRefill=="rate");
   double refillMaximumRate = control["refillMaximumRate"];
   double klatleaf = control["klatleaf"];
   double klatstem = control["klatstem"];
   int ntimesteps = control["ndailysteps"];
   int nsubsteps = control["nsubsteps"];
   String costWater = control["costWater"];
+  bool dEdPCost = (costWater=="dEdP");
   double costModifier = control["costModifier"];
   double gainModifier = control["gainModifier"];
   bool plantWaterPools = control["plantWaterPools"];
@@ -357,9 +402,12 @@ List transpirationSperry(List x, NumericVector meteovec,
     dU = Rcpp::as<Rcpp::NumericVector>(canopyTurbulence["du"]);
     uw = canopyTurbulence["uw"];
   } 
-  //4a. Instantaneous direct and diffuse shorwave radiation
-  DataFrame ddd = meteoland::radiation_directDiffuseDay(solarConstant, latrad, slorad, asprad, delta,
-                                                        rad, clearday, ntimesteps);
+  //4a. Instantaneous direct and diffuse shorwave radiation (taken from precomputed forcing, if available)
+  bool forcing_input = (subdailyForcing.size()>0);
+  DataFrame ddd;
+  if(forcing_input) ddd = Rcpp::as<Rcpp::DataFrame>(subdailyForcing);
+  else ddd = meteoland::radiation_directDiffuseDay(solarConstant, latrad, slorad, asprad, delta,
+                                                   rad, clearday, ntimesteps);
   NumericVector solarHour = ddd["SolarHour"]; //in radians
   
   //4b. Instantaneous air temperature (above canopy) and longwave radiation
@@ -369,15 +417,24 @@ List transpirationSperry(List x, NumericVector meteovec,
   NumericMatrix Tsoil_mat(ntimesteps, nlayers);
   NumericMatrix Tcan_mat(ntimesteps, ncanlayers);
   NumericMatrix VPcan_mat(ntimesteps, ncanlayers);
-  //Daylength in seconds (assuming flat area because we want to model air temperature variation)
-  double tauday = meteoland::radiation_daylengthseconds(latrad,0.0,0.0, delta); 
-  for(int n=0;n<ntimesteps;n++) {
-    //From solar hour (radians) to seconds from sunrise
-    Tsunrise[n] = (solarHour[n]*43200.0/M_PI)+ (tauday/2.0) +(tstep/2.0); 
-    //Calculate instantaneous temperature and light conditions
-    Tatm[n] = temperatureDiurnalPattern(Tsunrise[n], tmin, tmax, tminPrev, tmaxPrev, tminNext, tauday);
-    //Longwave sky diffuse radiation (W/m2)
-    lwdr[n] = meteoland::radiation_skyLongwaveRadiation(Tatm[n], vpatm, cloudcover);
+  if(forcing_input) {
+    NumericVector TatmForcing = subdailyForcing["Tatm"];
+    NumericVector lwdrForcing = subdailyForcing["LWR"];
+    for(int n=0;n<ntimesteps;n++) {
+      Tatm[n] = TatmForcing[n];
+      lwdr[n] = lwdrForcing[n];
+    }
+  } else {
+    //Daylength in seconds (assuming flat area because we want to model air temperature variation)
+    double tauday = meteoland::radiation_daylengthseconds(latrad,0.0,0.0, delta); 
+    for(int n=0;n<ntimesteps;n++) {
+      //From solar hour (radians) to seconds from sunrise
+      Tsunrise[n] = (solarHour[n]*43200.0/M_PI)+ (tauday/2.0) +(tstep/2.0); 
+      //Calculate instantaneous temperature and light conditions
+      Tatm[n] = temperatureDiurnalPattern(Tsunrise[n], tmin, tmax, tminPrev, tmaxPrev, tminNext, tauday);
+      //Longwave sky diffuse radiation (W/m2)
+      lwdr[n] = meteoland::radiation_skyLongwaveRadiation(Tatm[n], vpatm, cloudcover);
+    }
   }
   if(NumericVector::is_na(Tair[0])) {//If missing initialize canopy profile with atmospheric air temperature 
     for(int i=0;i<ncanlayers;i++) Tair[i] = Tatm[0];
@@ -504,6 +561,7 @@ List transpirationSperry(List x, NumericVector meteovec,
     //Calculate average rhizosphere moisture, including rhizosphere overlaps
     Wrhizo = cohortRhizosphereMoisture(Wpool, RHOP);
   }
+  double diagSupply = diagnosticsStart();
   List supply(numCohorts);
   List supplyAboveground(numCohorts);
   supply.attr("names") = above.attr("row.names");
@@ -562,6 +620,7 @@ List transpirationSperry(List x, NumericVector meteovec,
       stop("Plant cohort not connected to any soil layer!");
     }
   }
+  diagnosticsStop(DIAGNOSTICS_SUPPLY_FUNCTIONS, diagSupply);
   //Sugar conc in sapwood and leaf of each cohort
   NumericVector sugarLeaf(numCohorts, 0.0);
   NumericVector sugarSapwood(numCohorts, 0.0);
@@ -632,6 +691,28 @@ List transpirationSperry(List x, NumericVector meteovec,
   
   List lwrExtinctionList(ntimesteps);
   
+  //Scratch vectors for soil layer extraction and multi-layer canopy balance
+  int maxLayersCon = 0;
+  for(int c=0;c<numCohorts;c++) maxLayersCon = std::max(maxLayersCon, (int) nlayerscon[c]);
+  ScratchArena localArena;
+  if(arena==NULL) arena = &localArena;
+  arena->reset(2*maxLayersCon + 13*ncanlayers);
+  double* Esoilcn = arena->take(maxLayersCon);
+  double* ElayersVEC = arena->take(maxLayersCon);
+  double* Tairnext = arena->take(ncanlayers);
+  double* LElayer = arena->take(ncanlayers);
+  double* absSWRlayer = arena->take(ncanlayers);
+  double* Rnlayer = arena->take(ncanlayers);
+  double* Hleaflayer = arena->take(ncanlayers);
+  double* layerThermalCapacity = arena->take(ncanlayers);
+  double* moistureET = arena->take(ncanlayers);
+  double* rho = arena->take(ncanlayers);
+  double* moistureLayer = arena->take(ncanlayers);
+  double* moistureLayernext = arena->take(ncanlayers);
+  double* CO2An = arena->take(ncanlayers);
+  double* CO2Layer = arena->take(ncanlayers);
+  double* CO2Layernext = arena->take(ncanlayers);
+  
   for(int n=0;n<ntimesteps;n++) { //Time loop
     //Longwave radiation
     List lwrExtinction = longwaveRadiationSHAW(LAIme, LAImd, LAImx, 
@@ -716,69 +797,83 @@ List transpirationSperry(List x, NumericVector meteovec,
         //Get info from sFunctionAbove
         psiRootCrown = sFunctionAbove["psiRootCrown"];
         
-        if(fittedE.size()>0) {
-          //Photosynthesis function for sunlit and shade leaves
-          DataFrame photoSunlit = leafPhotosynthesisFunction2(fittedE, LeafPsi, Cair[iLayerSunlit[c]], Patm,
-                                                             Tair[iLayerSunlit[c]], VPair[iLayerSunlit[c]], 
-                                                             zWind[iLayerSunlit[c]], 
-                                                             SWR_SL(c,n), LWR_SL(c,n), 
-                                                             irradianceToPhotonFlux(PAR_SL(c,n)), 
-                                                             NSPLVEC[c]*Vmax298SL[c], 
-                                                             NSPLVEC[c]*Jmax298SL[c], 
-                                                             leafWidth[c], LAI_SL[c]);
-          DataFrame photoShade = leafPhotosynthesisFunction2(fittedE, LeafPsi, Cair[iLayerShade[c]], Patm,
-                                                            Tair[iLayerShade[c]], VPair[iLayerShade[c]], 
-                                                            zWind[iLayerShade[c]], 
-                                                            SWR_SH(c,n), LWR_SH(c,n), 
-                                                            irradianceToPhotonFlux(PAR_SH(c,n)),
-                                                            NSPLVEC[c]*Vmax298SH[c], 
-                                                            NSPLVEC[c]*Jmax298SH[c], 
-                                                            leafWidth[c], LAI_SH[c]);
-          
-          NumericVector AgSunlit = photoSunlit["GrossPhotosynthesis"];
-          NumericVector AgShade = photoShade["GrossPhotosynthesis"];
-          NumericVector AnSunlit = photoSunlit["NetPhotosynthesis"];
-          NumericVector AnShade = photoShade["NetPhotosynthesis"];
-          NumericVector GswSunlit = photoSunlit["Gsw"];
-          NumericVector GswShade = photoShade["Gsw"];
-          NumericVector CiSunlit = photoSunlit["Ci"];
-          NumericVector CiShade = photoShade["Ci"];
-          NumericVector VPDSunlit = photoSunlit["LeafVPD"];
-          NumericVector VPDShade = photoShade["LeafVPD"];
-          NumericVector TempSunlit = photoSunlit["LeafTemperature"];
-          NumericVector TempShade = photoShade["LeafTemperature"];
+        int nE = fittedE.size();
+        if(nE>0) {
+          //Photosynthesis functions for sunlit and shade leaves and profit maximization results, 
+          //in scratch memory (six buffers for each photosynthesis function, three for each profit maximization)
+          double* photoSunlit = arena->workspace(18*nE);
+          double* photoShade = photoSunlit + 6*nE;
+          double* PMSunlit = photoShade + 6*nE;
+          double* PMShade = PMSunlit + 3*nE;
+          double diagPhoto = diagnosticsStart();
+          leafPhotosynthesisFunction2Native(fittedE.begin(), LeafPsi.begin(), nE, 
+                                            Cair[iLayerSunlit[c]], Patm,
+                                            Tair[iLayerSunlit[c]], VPair[iLayerSunlit[c]], 
+                                            zWind[iLayerSunlit[c]], 
+                                            SWR_SL(c,n), LWR_SL(c,n), 
+                                            irradianceToPhotonFlux(PAR_SL(c,n)), 
+                                            NSPLVEC[c]*Vmax298SL[c], 
+                                            NSPLVEC[c]*Jmax298SL[c], 
+                                            leafWidth[c], LAI_SL[c],
+                                            photoSunlit, photoSunlit + nE, photoSunlit + 2*nE,
+                                            photoSunlit + 3*nE, photoSunlit + 4*nE, photoSunlit + 5*nE);
+          leafPhotosynthesisFunction2Native(fittedE.begin(), LeafPsi.begin(), nE, 
+                                            Cair[iLayerShade[c]], Patm,
+                                            Tair[iLayerShade[c]], VPair[iLayerShade[c]], 
+                                            zWind[iLayerShade[c]], 
+                                            SWR_SH(c,n), LWR_SH(c,n), 
+                                            irradianceToPhotonFlux(PAR_SH(c,n)),
+                                            NSPLVEC[c]*Vmax298SH[c], 
+                                            NSPLVEC[c]*Jmax298SH[c], 
+                                            leafWidth[c], LAI_SH[c],
+                                            photoShade, photoShade + nE, photoShade + 2*nE,
+                                            photoShade + 3*nE, photoShade + 4*nE, photoShade + 5*nE);
+          diagnosticsStop(DIAGNOSTICS_PHOTOSYNTHESIS, diagPhoto);
           
+          const double* TempSunlit = photoSunlit;
+          const double* TempShade = photoShade;
+          const double* VPDSunlit = photoSunlit + nE;
+          const double* VPDShade = photoShade + nE;
+          const double* GswSunlit = photoSunlit + 2*nE;
+          const double* GswShade = photoShade + 2*nE;
+          const double* CiSunlit = photoSunlit + 3*nE;
+          const double* CiShade = photoShade + 3*nE;
+          const double* AgSunlit = photoSunlit + 4*nE;
+          const double* AgShade = photoShade + 4*nE;
+          const double* AnSunlit = photoSunlit + 5*nE;
+          const double* AnShade = photoShade + 5*nE;
           
           //Profit maximization
-          List PMSunlit, PMShade;
+          NumericVector supplydEdP = sFunctionAbove["dEdP"];
+          NumericVector supplyKterm = sFunctionAbove["kterm"];
+          bool PMcomputed = false;
           int iPMSunlit = 0, iPMShade = 0;
-          
-          if(!cochard) { //Pure Sperry model
-            PMSunlit = profitMaximization(sFunctionAbove, photoSunlit,  Gswmin[c], Gswmax[c], gainModifier, costModifier, costWater);
-            PMShade = profitMaximization(sFunctionAbove, photoShade,  Gswmin[c],Gswmax[c], gainModifier, costModifier, costWater);
-            iPMSunlit = PMSunlit["iMaxProfit"];
-            iPMShade = PMShade["iMaxProfit"];
+          double diagPM = diagnosticsStart();
+          if(!cochard || !(LeafPsi[c] < psiTlp)) { //Pure Sperry model or leaf turgor not zero
+            iPMSunlit = profitMaximizationNative(fittedE.begin(), supplydEdP.begin(), supplyKterm.begin(), nE,
+                                                 AgSunlit, GswSunlit, TempSunlit, VPDSunlit,
+                                                 Gswmin[c], Gswmax[c], gainModifier, costModifier, dEdPCost,
+                                                 PMSunlit, PMSunlit + nE, PMSunlit + 2*nE);
+            iPMShade = profitMaximizationNative(fittedE.begin(), supplydEdP.begin(), supplyKterm.begin(), nE,
+                                                AgShade, GswShade, TempShade, VPDShade,
+                                                Gswmin[c], Gswmax[c], gainModifier, costModifier, dEdPCost,
+                                                PMShade, PMShade + nE, PMShade + 2*nE);
+            PMcomputed = true;
           } else {
-            if(LeafPsi[c] < psiTlp) {  //Is leaf turgor zero
-              iPMSunlit = 0;
-              iPMShade  = 0;
-              for(int j=0;j<(GswSunlit.size()-1);j++) if(GswSunlit[j]<Gswmin[c]) iPMSunlit++;
-              for(int j=0;j<(GswShade.size()-1);j++) if(GswShade[j]<Gswmin[c]) iPMShade++;
-            } else {
-              PMSunlit = profitMaximization(sFunctionAbove, photoSunlit,  Gswmin[c], Gswmax[c], gainModifier, costModifier, costWater);
-              PMShade = profitMaximization(sFunctionAbove, photoShade,  Gswmin[c],Gswmax[c], gainModifier, costModifier, costWater);
-              iPMSunlit = PMSunlit["iMaxProfit"];
-              iPMShade = PMShade["iMaxProfit"];
-            }
+            iPMSunlit = 0;
+            iPMShade  = 0;
+            for(int j=0;j<(nE-1);j++) if(GswSunlit[j]<Gswmin[c]) iPMSunlit++;
+            for(int j=0;j<(nE-1);j++) if(GswShade[j]<Gswmin[c]) iPMShade++;
           }
+          diagnosticsStop(DIAGNOSTICS_PROFIT_MAXIMIZATION, diagPM);
           
-          //Store?
+          //Store? (only then photosynthesis functions and profit maximization results become R objects)
           if(!IntegerVector::is_na(stepFunctions)) {
             if(n==stepFunctions) {
-              outPhotoSunlit[c] = photoSunlit;
-              outPhotoShade[c] = photoShade;
-              outPMSunlit[c] = PMSunlit;
-              outPMShade[c] = PMShade;
+              outPhotoSunlit[c] = photosynthesisFunctionDataFrame(photoSunlit, nE);
+              outPhotoShade[c] = photosynthesisFunctionDataFrame(photoShade, nE);
+              outPMSunlit[c] = (PMcomputed ? profitMaximizationList(PMSunlit, nE, iPMSunlit) : List());
+              outPMShade[c] = (PMcomputed ? profitMaximizationList(PMShade, nE, iPMShade) : List());
             }
           }
           // Rcout<<iPMSunlit<<" "<<iPMShade <<" "<<GwSunlit[iPMSunlit]<<" "<<GwShade[iPMShade]<<" "<<fittedE[iPMSunlit]<<" "<<fittedE[iPMShade]<<"\n";
@@ -836,8 +931,8 @@ List transpirationSperry(List x, NumericVector meteovec,
           //Scale from instantaneous flow to water volume in the time step
           Einst(c,n) = fittedE[iPM]*0.001*0.01802*LAIphe[c]*tstep; 
           
-          NumericVector Esoilcn(nlayerscon[c],0.0);
-          NumericVector ElayersVEC(nlayerscon[c],0.0);
+          std::fill(Esoilcn, Esoilcn + nlayerscon[c], 0.0);
+          std::fill(ElayersVEC, ElayersVEC + nlayerscon[c], 0.0);
           
           
           //Get info from sFunctionBelow (this will be different depending on wether capacitance is considered)
@@ -864,7 +959,7 @@ List transpirationSperry(List x, NumericVector meteovec,
             LeafSympPsiVEC[c] = LeafPsiVEC[c]; //Leaf symplastic compartment coupled with apoplastic compartment
             
             // Store the PLC corresponding to stem1 water potential
-            if(cavitationRefill!="total") {
+            if(!totalRefill) {
               StemPLCVEC[c] = std::max(StemPLCVEC[c], 1.0 - xylemConductance(Stem1PsiVEC[c], 1.0, VCstem_c[c], VCstem_d[c])); 
             } else { //Immediate refilling
               StemPLCVEC[c] = 1.0 - xylemConductance(Stem1PsiVEC[c], 1.0, VCstem_c[c], VCstem_d[c]); 
@@ -893,6 +988,7 @@ List transpirationSperry(List x, NumericVector meteovec,
             double Vcav = 0.0;
             //Perform water balance
             // Rcout<<"\n"<<c<<" Before - iPM " << iPM<< " EinstVEC[c]: "<< EinstVEC[c]<<" Vol: "<<VStemApo_mmol<<" RWC:"<< RWCStemApo <<" Psi: "<< Stem1PsiVEC[c]<< " LeafPsiVEC[c]: "<<LeafPsiVEC[c]<<"\n";
+            double diagCapacitance = diagnosticsStart();
             for(double scnt=0.0; scnt<tstep;scnt += 1.0) {
               //Find flow corresponding to Stem1PsiVEC[c]
               //Find iPM for water potential corresponding to the current water potential
@@ -944,7 +1040,7 @@ List transpirationSperry(List x, NumericVector meteovec,
 
               //Recalculate PLC and calculate volume corresponding to new cavitation
               double plc_old = StemPLCVEC[c];
-              if(cavitationRefill!="total") {
+              if(!totalRefill) {
                 StemPLCVEC[c] = std::max(StemPLCVEC[c], 1.0 - xylemConductance(Stem1PsiVEC[c], 1.0, VCstem_c[c], VCstem_d[c])); 
                 Vcav = VStemApo_mmolmax*(StemPLCVEC[c]-plc_old);
               } else { //Immediate refilling
@@ -957,6 +1053,7 @@ List transpirationSperry(List x, NumericVector meteovec,
               //   if(scnt>10.0) stop("");
               // }
             }
+            diagnosticsStop(DIAGNOSTICS_CAPACITANCE, diagCapacitance);
             
             // Rcout<<c<<" after - EinstVEC: "<<EinstVEC[c] << " RWCStemApo: " << RWCStemApo << "  Stem1PsiVEC:"<< Stem1PsiVEC[c]<<" StemSympPsiVEC: "<< StemSympPsiVEC[c]<<" LeafSympPsiVEC: "<< LeafSympPsiVEC[c] <<"\n";
 
@@ -976,7 +1073,7 @@ List transpirationSperry(List x, NumericVector meteovec,
           }
           
           //Balance between extraction and transpiration
-          PWBinst(c,n) = sum(Esoilcn) - Einst(c,n);
+          PWBinst(c,n) = std::accumulate(Esoilcn, Esoilcn + nlayerscon[c], 0.0) - Einst(c,n);
           
           //Add step transpiration to daily plant cohort transpiration
           Eplant[c] += Einst(c,n);
@@ -1065,6 +1162,7 @@ List transpirationSperry(List x, NumericVector meteovec,
     } //End of cohort loop
     
     //CANOPY AND SOIL ENERGY BALANCE
+    double diagEnergy = diagnosticsStart();
     
     //Soil latent heat (soil evaporation)
     //Latent heat (snow fusion) as J/m2/s
@@ -1128,16 +1226,11 @@ List transpirationSperry(List x, NumericVector meteovec,
       NumericVector LWRnet_layer = LWR_layer["Lnet"];
       Ebal[n] = 0.0;
       LEcan_heat[n] = 0.0;
-      NumericVector Tairnext(ncanlayers), LElayer(ncanlayers), absSWRlayer(ncanlayers), Rnlayer(ncanlayers), Hleaflayer(ncanlayers);
-      NumericVector layerThermalCapacity(ncanlayers);
-      NumericVector moistureET(ncanlayers), rho(ncanlayers), moistureLayer(ncanlayers), moistureLayernext(ncanlayers);
-      NumericVector CO2An(ncanlayers), CO2Layer(ncanlayers), CO2Layernext(ncanlayers);
       for(int i=0;i<ncanlayers;i++) {
         rho[i] = meteoland::utils_airDensity(Tair[i],Patm);
         absSWRlayer[i] = sum(absSWR_SL_ML(i,_)) + sum(absSWR_SH_ML(i,_));
         //Radiation balance
         Rnlayer[i] = absSWRlayer[i] + LWRnet_layer[i];
-        NumericVector pLayer = LAIme(i,_)/LAIphe; //Proportion of each cohort LAI in layer i
         //Instantaneous layer transpiration
         //from mmolH2O/m2/s to kgH2O/m2/s
         double ElayerInst = 0.001*0.01802*sum(LAIme(i,_)*(E_SL(_,n)*fsunlit[i] + E_SH(_,n)*(1.0-fsunlit[i])));
@@ -1243,6 +1336,7 @@ List transpirationSperry(List x, NumericVector meteovec,
       Tcan_mat(n+1,i) = Tair[i];
       VPcan_mat(n+1,i) = VPair[i];
     }
+    diagnosticsStop(DIAGNOSTICS_ENERGY_BALANCE, diagEnergy);
   } //End of timestep loop
 
   //4z. Plant daily drought stress (from root collar mid-day water potential)
@@ -1259,7 +1353,7 @@ List transpirationSperry(List x, NumericVector meteovec,
     double maxConductance = maximumSoilPlantConductance(VGrhizo_kmax(c,_), VCroot_kmax(c,_), VCstem_kmax[c], VCleaf_kmax[c]);
     DDS[c] = Phe[c]*(1.0 - (dEdPm[c]/(sapFluidityDay*maxConductance)));
     
-    if(cavitationRefill=="rate") {
+    if(rateRefill) {
       double SAmax = 10e4/Al2As[c]; //cm2·m-2 of leaf area
       double r = refillMaximumRate*std::max(0.0, (StemSympPsiVEC[c] + 1.5)/1.5);
       StemPLCVEC[c] = std::max(0.0, StemPLCVEC[c] - (r/SAmax));
@@ -1313,44 +1407,46 @@ List transpirationSperry(List x, NumericVector meteovec,
     EB["TemperatureLayers"] = Tcan_mat;
     EB["VaporPressureLayers"] = VPcan_mat;
   }
-  E_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  E_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Psi_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Psi_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  An_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  An_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Ag_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Ag_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  SWR_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  SWR_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  PAR_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  PAR_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LWR_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LWR_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Ci_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Ci_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  GSW_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  GSW_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Temp_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Temp_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  VPD_SH.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  VPD_SL.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
+  //Dimension names shared by all cohort x timestep output matrices
+  List cohortStepNames = List::create(above.attr("row.names"), seq(1,ntimesteps));
+  E_SH.attr("dimnames") = cohortStepNames;
+  E_SL.attr("dimnames") = cohortStepNames;
+  Psi_SH.attr("dimnames") = cohortStepNames;
+  Psi_SL.attr("dimnames") = cohortStepNames;
+  An_SH.attr("dimnames") = cohortStepNames;
+  An_SL.attr("dimnames") = cohortStepNames;
+  Ag_SH.attr("dimnames") = cohortStepNames;
+  Ag_SL.attr("dimnames") = cohortStepNames;
+  SWR_SH.attr("dimnames") = cohortStepNames;
+  SWR_SL.attr("dimnames") = cohortStepNames;
+  PAR_SH.attr("dimnames") = cohortStepNames;
+  PAR_SL.attr("dimnames") = cohortStepNames;
+  LWR_SH.attr("dimnames") = cohortStepNames;
+  LWR_SL.attr("dimnames") = cohortStepNames;
+  Ci_SH.attr("dimnames") = cohortStepNames;
+  Ci_SL.attr("dimnames") = cohortStepNames;
+  GSW_SH.attr("dimnames") = cohortStepNames;
+  GSW_SL.attr("dimnames") = cohortStepNames;
+  Temp_SH.attr("dimnames") = cohortStepNames;
+  Temp_SL.attr("dimnames") = cohortStepNames;
+  VPD_SH.attr("dimnames") = cohortStepNames;
+  VPD_SL.attr("dimnames") = cohortStepNames;
 
-  Einst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  dEdPInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LeafPsiInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  StemPsiInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LeafSympPsiInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  StemSympPsiInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  RootPsiInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Aginst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  Aninst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  PLC.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LeafRWCInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  StemRWCInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  LeafSympRWCInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  StemSympRWCInst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
-  PWBinst.attr("dimnames") = List::create(above.attr("row.names"), seq(1,ntimesteps));
+  Einst.attr("dimnames") = cohortStepNames;
+  dEdPInst.attr("dimnames") = cohortStepNames;
+  LeafPsiInst.attr("dimnames") = cohortStepNames;
+  StemPsiInst.attr("dimnames") = cohortStepNames;
+  LeafSympPsiInst.attr("dimnames") = cohortStepNames;
+  StemSympPsiInst.attr("dimnames") = cohortStepNames;
+  RootPsiInst.attr("dimnames") = cohortStepNames;
+  Aginst.attr("dimnames") = cohortStepNames;
+  Aninst.attr("dimnames") = cohortStepNames;
+  PLC.attr("dimnames") = cohortStepNames;
+  LeafRWCInst.attr("dimnames") = cohortStepNames;
+  StemRWCInst.attr("dimnames") = cohortStepNames;
+  LeafSympRWCInst.attr("dimnames") = cohortStepNames;
+  StemSympRWCInst.attr("dimnames") = cohortStepNames;
+  PWBinst.attr("dimnames") = cohortStepNames;
   minPsiRhizo.attr("dimnames") = List::create(above.attr("row.names"), seq(1,nlayers));
   soilLayerExtractInst.attr("dimnames") = List::create(seq(1,nlayers), seq(1,ntimesteps));
   for(int c=0;c<numCohorts;c++) {
@@ -1359,6 +1455,44 @@ List transpirationSperry(List x, NumericVector meteovec,
     Vmax298SH[c] = Vmax298SH[c]/LAI_SH[c];
     Jmax298SH[c] = Jmax298SH[c]/LAI_SH[c];
   }
+  //Daily photosynthesis-weighted leaf intrinsic water use efficiency (An/gsw) and intercellular CO2
+  NumericVector LeafiWUE_SL(numCohorts, NA_REAL), LeafiWUE_SH(numCohorts, NA_REAL), LeafiWUE(numCohorts, NA_REAL);
+  NumericVector LeafCi_SL(numCohorts, NA_REAL), LeafCi_SH(numCohorts, NA_REAL), LeafCi(numCohorts, NA_REAL);
+  for(int c=0;c<numCohorts;c++) {
+    double laiTot = LAI_SL[c] + LAI_SH[c];
+    double sumAn_SL = 0.0, sumAn_SH = 0.0, sumAn = 0.0;
+    double sumWUE_SL = 0.0, sumWUE_SH = 0.0, sumWUE = 0.0;
+    double sumCi_SL = 0.0, sumCi_SH = 0.0, sumCi = 0.0;
+    for(int n=0;n<ntimesteps;n++) {
+      double an_SL = std::max(0.0, An_SL(c,n));
+      double an_SH = std::max(0.0, An_SH(c,n));
+      double wue_SL = an_SL/GSW_SL(c,n);
+      double wue_SH = an_SH/GSW_SH(c,n);
+      double wue = std::max(0.0, (wue_SL*LAI_SL[c] + wue_SH*LAI_SH[c])/laiTot);
+      double ci = (Ci_SL(c,n)*LAI_SL[c] + Ci_SH(c,n)*LAI_SH[c])/laiTot;
+      sumAn_SL += an_SL;
+      sumAn_SH += an_SH;
+      sumAn += an_SL + an_SH;
+      if(std::isfinite(wue_SL)) sumWUE_SL += wue_SL*an_SL;
+      if(std::isfinite(wue_SH)) sumWUE_SH += wue_SH*an_SH;
+      if(std::isfinite(wue)) sumWUE += wue*(an_SL + an_SH);
+      if(std::isfinite(Ci_SL(c,n))) sumCi_SL += Ci_SL(c,n)*an_SL;
+      if(std::isfinite(Ci_SH(c,n))) sumCi_SH += Ci_SH(c,n)*an_SH;
+      if(std::isfinite(ci)) sumCi += ci*(an_SL + an_SH);
+    }
+    if(sumAn_SL > 0.0) {
+      LeafiWUE_SL[c] = sumWUE_SL/sumAn_SL;
+      LeafCi_SL[c] = sumCi_SL/sumAn_SL;
+    }
+    if(sumAn_SH > 0.0) {
+      LeafiWUE_SH[c] = sumWUE_SH/sumAn_SH;
+      LeafCi_SH[c] = sumCi_SH/sumAn_SH;
+    }
+    if(sumAn > 0.0) {
+      LeafiWUE[c] = sumWUE/sumAn;
+      LeafCi[c] = sumCi/sumAn;
+    }
+  }
   DataFrame Sunlit = DataFrame::create(
     _["LAI"] = LAI_SL, 
     _["Vmax298"] = Vmax298SL,
@@ -1368,7 +1502,9 @@ List transpirationSperry(List x, NumericVector meteovec,
     _["GSWMin"] = minGSW_SL,
     _["GSWMax"] = maxGSW_SL,
     _["TempMin"] = minTemp_SL,
-    _["TempMax"] = maxTemp_SL  
+    _["TempMax"] = maxTemp_SL,
+    _["iWUE"] = LeafiWUE_SL,
+    _["Ci"] = LeafCi_SL
   );
   DataFrame Shade = DataFrame::create(
     _["LAI"] = LAI_SH, 
@@ -1379,7 +1515,9 @@ List transpirationSperry(List x, NumericVector meteovec,
     _["GSWMin"] = minGSW_SH,
     _["GSWMax"] = maxGSW_SH,
     _["TempMin"] = minTemp_SH,
-    _["TempMax"] = maxTemp_SH  
+    _["TempMax"] = maxTemp_SH,
+    _["iWUE"] = LeafiWUE_SH,
+    _["Ci"] = LeafCi_SH
   );
   Sunlit.attr("row.names") = above.attr("row.names");
   Shade.attr("row.names") = above.attr("row.names");
@@ -1434,6 +1572,8 @@ List transpirationSperry(List x, NumericVector meteovec,
                                        _["StemPLC"] = PLCm, //Average daily stem PLC
                                        _["LeafPsiMin"] = minLeafPsi, 
                                        _["LeafPsiMax"] = maxLeafPsi, 
+                                       _["LeafiWUE"] = LeafiWUE,
+                                       _["LeafCi"] = LeafCi,
                                        _["dEdP"] = dEdPm,//Average daily soilplant conductance
                                        _["DDS"] = DDS, //Daily drought stress is the ratio of average soil plant conductance over its maximum value
                                        _["StemRWC"] = RWCsm,
@@ -1562,6 +1702,7 @@ List transpirationGranier(List x, NumericVector meteovec,
   //Control parameters
   List control = x["control"];
   String cavitationRefill = control["cavitationRefill"];
+  bool totalRefill = (cavitationRefill=="total");
   String soilFunctions = control["soilFunctions"];
   double verticalLayerSize = control["verticalLayerSize"];
   bool plantWaterPools = control["plantWaterPools"];
@@ -1690,7 +1831,7 @@ List transpirationGranier(List x, NumericVector meteovec,
       RootPsi(c,l) = psiSoil[l]; //Set initial guess of root potential to soil values
       Klc[l] = Psi2K(psiSoil[l], Psi_Extract[c], WeibullShape);
       //Limit Mean Kl due to previous cavitation
-      if(cavitationRefill!="total") {
+      if(!totalRefill) {
         Klc[l] = std::min(Klc[l], 1.0-StemPLC[c]); 
       }
       LSc[l] = Klc[l];
@@ -1716,7 +1857,7 @@ List transpirationGranier(List x, NumericVector meteovec,
 
   for(int c=0;c<numCohorts;c++) {
     PlantPsi[c] = averagePsi(RootPsi(c,_), V(c,_), WeibullShape, Psi_Extract[c]);
-    if(cavitationRefill!="total") {
+    if(!totalRefill) {
       StemPLC[c] = std::max(1.0 - Psi2K(PlantPsi[c],Psi_Critic[c],WeibullShape), StemPLC[c]); //Track current embolism if no refill
     } else {
       StemPLC[c] = 1.0 - Psi2K(PlantPsi[c],Psi_Critic[c],WeibullShape);
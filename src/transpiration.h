@@ -3,6 +3,7 @@
 #ifndef TRANSPIRATION_H
 #define TRANSPIRATION_H
 #endif
+#include "scratcharena.h"
 using namespace Rcpp;
 
 List profitMaximization(List supplyFunction, DataFrame photosynthesisFunction, double Gswmin, double Gswmax, 
@@ -14,4 +15,5 @@ List transpirationSperry(List x, NumericVector meteovec,
                   double solarConstant, double delta,
                   double canopyEvaporation = 0.0, double snowMelt = 0.0, double soilEvaporation = 0.0,
                   bool verbose = false, int stepFunctions = NA_INTEGER, 
-                  bool modifyInput = true);
\ No newline at end of file
+                  bool modifyInput = true, List subdailyForcing = List(), 
+                  ScratchArena* arena = NULL);
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <Rcpp.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "forestutils.h"
+#include "paramutils.h"
+using namespace Rcpp;
+
+/**
+ *  Vertical profiles of leaf area, fuel and light extinction. All profiles derive from the
+ *  amount of crown (leaf area, fuel, ...) located above each height, which is calculated
+ *  once by sorting heights and sweeping cohort crown bounds.
+ */
+
+/**
+ * Amount of crown weight 'w' above each height 'z', for each group of cohorts (heights in rows,
+ * groups in columns, column-major). Cohorts whose crown base is above a given height contribute
+ * their whole weight, cohorts whose crown is below contribute nothing and only heights within
+ * the crown require evaluating the leaf area distribution. Cohorts with missing group or weight
+ * are skipped if 'skipMissing = true', otherwise all values of their group are missing.
+ */
+std::vector<double> crownAmountAbove(NumericVector z, NumericVector w, NumericVector H, NumericVector CR,
+                                     IntegerVector group, int numGroups, bool skipMissing) {
+  int nz = z.size();
+  int ncoh = w.size();
+  std::vector<int> ord(nz);
+  for(int i=0;i<nz;i++) ord[i] = i;
+  std::sort(ord.begin(), ord.end(), [&z](int a, int b) {return z[a] < z[b];});
+  std::vector<double> zs(nz);
+  for(int i=0;i<nz;i++) zs[i] = z[ord[i]];
+  std::vector<double> full((nz+1)*numGroups, 0.0);
+  std::vector<double> partial(nz*numGroups, 0.0);
+  std::vector<bool> missing(numGroups, false);
+  for(int c=0;c<ncoh;c++) {
+    int g = (group.size()>0 ? group[c] : 1);
+    if(g==NA_INTEGER || g<1 || g>numGroups) continue;
+    g = g - 1;
+    if(NumericVector::is_na(w[c]) || NumericVector::is_na(H[c]) || NumericVector::is_na(CR[c])) {
+      if(!skipMissing) missing[g] = true;
+      continue;
+    }
+    if(w[c]==0.0) continue;
+    double cbh = H[c]*(1.0-CR[c]);
+    int a = std::lower_bound(zs.begin(), zs.end(), cbh) - zs.begin();
+    int b = std::lower_bound(zs.begin() + a, zs.end(), H[c]) - zs.begin();
+    double wfull = w[c]*leafAreaProportion(cbh, H[c], cbh, H[c]);
+    full[g*(nz+1)] += wfull;
+    full[g*(nz+1) + a] -= wfull;
+    for(int i=a;i<b;i++) partial[g*nz + i] += w[c]*leafAreaProportion(zs[i], H[c], cbh, H[c]);
+  }
+  std::vector<double> res(nz*numGroups, 0.0);
+  for(int g=0;g<numGroups;g++) {
+    double cum = 0.0;
+    for(int i=0;i<nz;i++) {
+      cum += full[g*(nz+1) + i];
+      res[g*nz + ord[i]] = (missing[g] ? NA_REAL : cum + partial[g*nz + i]);
+    }
+  }
+  return(res);
+}
+
+/**
+ * Profiles from cohort vectors: leaf area (m2/m2) in each height bin (by groups if supplied),
+ * percentage of PAR and SWR at each height (if 'kPAR' is supplied) and fuel bulk density
+ * (kg/m3) in each height bin (if 'fuel' is supplied, in kg/m2). With a single height there 
+ * are no height bins, and only PAR and SWR are evaluated.
+ */
+// [[Rcpp::export(".verticalProfileVectors")]]
+List verticalProfileVectors(NumericVector z, NumericVector LAI, NumericVector H, NumericVector CR,
+                            NumericVector kPAR = NumericVector(0), NumericVector fuel = NumericVector(0),
+                            IntegerVector group = IntegerVector(0), int numGroups = 0) {
+  int nz = z.size();
+  if(nz<1) stop("At least one height value is needed.");
+  int ncoh = LAI.size();
+  if(H.size()!=ncoh || CR.size()!=ncoh) stop("Cohort vectors should have the same length.");
+  IntegerVector noGroup(0);
+  List res;
+  std::vector<double> lai = crownAmountAbove(z, LAI, H, CR, noGroup, 1, false);
+  NumericVector laiLayer(nz-1);
+  for(int i=0;i<(nz-1);i++) laiLayer[i] = lai[i] - lai[i+1];
+  res.push_back(laiLayer, "LAI");
+  if(kPAR.size()>0) {
+    if(kPAR.size()!=ncoh) stop("Vector 'kPAR' should have the same length as 'LAI'.");
+    NumericVector kLAI = kPAR*LAI;
+    std::vector<double> s = crownAmountAbove(z, kLAI, H, CR, noGroup, 1, false);
+    NumericVector PAR(nz), SWR(nz);
+    for(int i=0;i<nz;i++) {
+      PAR[i] = 100.0*exp(-1.0*s[i]);
+      SWR[i] = 100.0*exp(-1.0*s[i]/1.35);
+    }
+    res.push_back(PAR, "PAR");
+    res.push_back(SWR, "SWR");
+  }
+  if(fuel.size()>0) {
+    if(fuel.size()!=ncoh) stop("Vector 'fuel' should have the same length as 'LAI'.");
+    std::vector<double> f = crownAmountAbove(z, fuel, H, CR, noGroup, 1, false);
+    NumericVector wfp(nz-1);
+    //Change units from kg/(m3*cm) to kg/m3
+    for(int i=0;i<(nz-1);i++) wfp[i] = 100.0*(f[i] - f[i+1])/(z[i+1]-z[i]);
+    res.push_back(wfp, "fuel");
+  }
+  if(group.size()>0) {
+    if(group.size()!=ncoh) stop("Vector 'group' should have the same length as 'LAI'.");
+    std::vector<double> lg = crownAmountAbove(z, LAI, H, CR, group, numGroups, true);
+    NumericMatrix laiGroups(nz-1, numGroups);
+    for(int g=0;g<numGroups;g++) {
+      for(int i=0;i<(nz-1);i++) laiGroups(i,g) = lg[g*nz + i] - lg[g*nz + i + 1];
+    }
+    res.push_back(laiGroups, "LAIgroups");
+  }
+  return(res);
+}
+
+/**
+ * Profiles of leaf area density (m2/m3), fuel bulk density (kg/m3) and percentage of PAR and SWR
+ * for a list of forest objects. Densities correspond to the height bin below each height (zero
+ * for the first height). If 'z' is empty, heights are defined for each forest every 10 cm up to
+ * 10 cm above the next meter over the maximum cohort height. Only the profiles named in 'profiles'
+ * are calculated and returned (cohort fuel is not needed for light extinction, for example).
+ */
+// [[Rcpp::export(".verticalProfilesForests")]]
+List verticalProfilesForests(List forests, NumericVector z, DataFrame SpParams,
+                             double gdd = NA_REAL, String mode = "MED",
+                             CharacterVector profiles = CharacterVector::create("LAD", "BD", "PAR", "SWR")) {
+  bool doLAD = false, doBD = false, doPAR = false, doSWR = false;
+  for(int p=0;p<profiles.size();p++) {
+    String prof = profiles[p];
+    if(prof=="LAD") doLAD = true;
+    else if(prof=="BD") doBD = true;
+    else if(prof=="PAR") doPAR = true;
+    else if(prof=="SWR") doSWR = true;
+    else stop("Wrong profile name. Valid names are 'LAD', 'BD', 'PAR' and 'SWR'.");
+  }
+  IntegerVector noGroup(0);
+  int nf = forests.size();
+  List res(nf);
+  for(int f=0;f<nf;f++) {
+    List x = forests[f];
+    DataFrame above = forest2aboveground(x, SpParams, gdd, mode);
+    IntegerVector SP = above["SP"];
+    NumericVector H = above["H"];
+    NumericVector LAI = above["LAI_expanded"];
+    NumericVector CR = above["CR"];
+    NumericVector zf = z;
+    if(z.size()==0) {
+      double maxH = 0.0;
+      for(int c=0;c<H.size();c++) if(!NumericVector::is_na(H[c])) maxH = std::max(maxH, H[c]);
+      int nz = (int) ((ceil(maxH/100.0)*100.0 + 10.0)/10.0) + 1;
+      zf = NumericVector(nz);
+      for(int i=0;i<nz;i++) zf[i] = 10.0*((double) i);
+    }
+    int nz = zf.size();
+    List df;
+    df.push_back(zf, "z");
+    if(doLAD) {
+      std::vector<double> lai = crownAmountAbove(zf, LAI, H, CR, noGroup, 1, false);
+      NumericVector LAD(nz, 0.0);
+      for(int i=1;i<nz;i++) LAD[i] = 100.0*(lai[i-1] - lai[i])/(zf[i]-zf[i-1]);
+      df.push_back(LAD, "LAD");
+    }
+    if(doBD) {
+      NumericVector fuel = cohortFuel(x, SpParams, gdd, true, mode);
+      std::vector<double> fa = crownAmountAbove(zf, fuel, H, CR, noGroup, 1, false);
+      NumericVector BD(nz, 0.0);
+      //Change units from kg/(m3*cm) to kg/m3
+      for(int i=1;i<nz;i++) BD[i] = 100.0*(fa[i-1] - fa[i])/(zf[i]-zf[i-1]);
+      df.push_back(BD, "BD");
+    }
+    if(doPAR || doSWR) {
+      NumericVector kPAR = speciesNumericParameterWithImputation(SP, SpParams, "kPAR", true);
+      NumericVector kLAI = kPAR*LAI;
+      std::vector<double> s = crownAmountAbove(zf, kLAI, H, CR, noGroup, 1, false);
+      NumericVector PAR(nz), SWR(nz);
+      for(int i=0;i<nz;i++) {
+        PAR[i] = 100.0*exp(-1.0*s[i]);
+        SWR[i] = 100.0*exp(-1.0*s[i]/1.35);
+      }
+      if(doPAR) df.push_back(PAR, "PAR");
+      if(doSWR) df.push_back(SWR, "SWR");
+    }
+    res[f] = DataFrame(df);
+  }
+  res.attr("names") = forests.attr("names");
+  return(res);
+}